@@ -0,0 +1,171 @@
+// Differential fuzzer for the rule implementations.
+//
+// Plays one move sequence through the reference State, the geometry-generic
+// BasicState<2> and the VecEnv kernel, and after every move compares the
+// legal move sets (and the moves the playout policy enumerates), sub-board
+// masks, meta masks, winner and side to move. It also checks State's
+// incremental Zobrist hash against a full recompute.
+// Any mismatch prints the move sequence and aborts.
+//
+// Each input byte picks the next move (modulo the number of legal moves,
+// in cell order); missing bytes pick the first legal move.
+//
+// Standalone random driver, one thread per core:
+//   g++ -O2 -std=c++17 -pthread fuzz/state_diff.cpp -o state_diff
+//   ./state_diff [seconds] [--threads N] [--seed N]
+// libFuzzer:
+//   clang++ -O1 -g -std=c++17 -fsanitize=fuzzer,address
+//       -DUTTT_LIBFUZZER fuzz/state_diff.cpp -o state_diff_fuzz
+
+#include <atomic>
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../uttt/flags.h"
+#include "../uttt/geometry.h"
+#include "../uttt/policy.h"
+#include "../uttt/state.h"
+#include "../uttt/vecenv.h"
+
+using namespace std;
+
+using MoveSet = bitset<81>;
+
+template <class S> MoveSet move_set(const S &st) {
+  MoveSet set;
+  for (const auto &mv : st.get_valid_moves())
+    set.set(mv.first * 9 + mv.second);
+  return set;
+}
+
+// Moves the playout policy chooses from
+inline MoveSet pattern_move_set(const State &st) {
+  MoveSet set;
+  for_each_pattern_move(st, [&](int cell, int, int) { set.set(cell); });
+  return set;
+}
+
+inline MoveSet move_set(const VecEnv &env) {
+  MoveSet set;
+  for (int a = 0; a < 81; ++a)
+    if (env.is_legal(0, a))
+      set.set(a);
+  return set;
+}
+
+[[noreturn]] inline void mismatch(const char *what,
+                                  const vector<int> &cells) {
+  cerr << "mismatch in " << what << " after moves:";
+  for (int c : cells)
+    cerr << " " << c / 9 << " " << c % 9;
+  cerr << endl;
+  abort();
+}
+
+// Plays the game chosen by data; returns the number of moves played
+inline int run_game(const uint8_t *data, size_t size) {
+  State ref;
+  BasicState<2> generic;
+  VecEnv env(1, 0);
+  vector<int> cells;
+  int env_winner = 0;
+
+  for (size_t i = 0; !ref.is_terminal(); ++i) {
+    MoveSet legal = move_set(ref);
+    if (move_set(generic) != legal)
+      mismatch("BasicState<2> legal moves", cells);
+    if (move_set(env) != legal)
+      mismatch("VecEnv legal moves", cells);
+    if (pattern_move_set(ref) != legal)
+      mismatch("playout policy moves", cells);
+
+    int k = i < size ? data[i] % legal.count() : 0;
+    int cell = 0;
+    while (!legal[cell] || k-- > 0)
+      ++cell;
+    cells.push_back(cell);
+    pair<int, int> mv = {cell / 9, cell % 9};
+    ref.apply_move(mv);
+    generic.apply_move(mv);
+    env_winner = env.apply(0, cell);
+
+    if (ref.hash != ref.compute_hash())
+      mismatch("incremental hash", cells);
+    for (int s = 0; s < 9; ++s) {
+      if (static_cast<int>(generic.leaf[s]) != ref.sub[s])
+        mismatch("BasicState<2> sub-boards", cells);
+      if ((env.x[s] | env.o[s] << 9) != ref.sub[s])
+        mismatch("VecEnv sub-boards", cells);
+    }
+    if (generic.childX[0] != ref.metaX || generic.childO[0] != ref.metaO ||
+        generic.childD[0] != ref.metaD)
+      mismatch("BasicState<2> meta masks", cells);
+    if (env.metaX[0] != ref.metaX || env.metaO[0] != ref.metaO ||
+        env.metaD[0] != ref.metaD)
+      mismatch("VecEnv meta masks", cells);
+    if (generic.winner != ref.winner)
+      mismatch("BasicState<2> winner", cells);
+    if (env_winner != ref.winner)
+      mismatch("VecEnv winner", cells);
+    if (generic.turnX != ref.turnX || (env.turnX[0] != 0) != ref.turnX)
+      mismatch("side to move", cells);
+  }
+  return static_cast<int>(cells.size());
+}
+
+#ifdef UTTT_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+  run_game(data, size);
+  return 0;
+}
+
+#else
+
+int main(int argc, char **argv) {
+  Flags flags(argc, argv);
+  double seconds =
+      flags.positional.empty() ? 10.0 : atof(flags.positional[0].c_str());
+  int threads = flags.get("threads", int(thread::hardware_concurrency()));
+  unsigned seed = static_cast<unsigned>(flags.get("seed", 1));
+  threads = max(threads, 1);
+
+  atomic<long> games{0}, moves{0};
+  auto deadline = chrono::steady_clock::now() +
+                  chrono::duration_cast<chrono::steady_clock::duration>(
+                      chrono::duration<double>(seconds));
+  vector<thread> workers;
+  for (int t = 0; t < threads; ++t)
+    workers.emplace_back([&, t] {
+      mt19937_64 rng(seed * 1000003ULL + t);
+      uint8_t buf[96];
+      long local_games = 0, local_moves = 0;
+      while ((local_games & 255) || chrono::steady_clock::now() < deadline) {
+        for (size_t i = 0; i < sizeof(buf); i += 8) {
+          uint64_t r = rng();
+          for (int j = 0; j < 8; ++j)
+            buf[i + j] = static_cast<uint8_t>(r >> (8 * j));
+        }
+        local_moves += run_game(buf, sizeof(buf));
+        ++local_games;
+      }
+      games += local_games;
+      moves += local_moves;
+    });
+  for (auto &w : workers)
+    w.join();
+  cout << games << " games, " << moves << " moves, " << threads
+       << " threads: no mismatches (" << static_cast<long>(games * 60 / seconds)
+       << " games/min)" << endl;
+  return 0;
+}
+
+#endif
@@ -0,0 +1,225 @@
+// Distributed root-parallel MCTS for offline analysis.
+//
+//   mcts-dist worker ADDR
+//       Serve searches on ADDR (unix:/path or tcp:host:port).
+//   mcts-dist search [--workers ADDR,...] [--local N] [--time S]
+//                    [--sync MS] [--moves "r c r c ..."]
+//       Search one position with remote workers and/or N forked local ones.
+//   mcts-dist scale MAX_WORKERS [S] [MS]
+//       Search the bench positions with 1, 2, 4, ... MAX_WORKERS local
+//       workers and report iterations/sec and agreement with a reference
+//       search MAX_WORKERS times as long.
+//
+// Build: g++ -O2 -std=c++17 mcts-dist.cpp -o mcts-dist
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "uttt/bench.h"
+#include "uttt/distributed.h"
+#include "uttt/mcts.h"
+#include "uttt/moves.h"
+#include "uttt/net.h"
+
+using namespace std;
+
+static vector<pid_t> local_pids;
+
+// Fork n workers, each connected to the coordinator by a socket pair
+static bool spawn_local_workers(int n, Coordinator &coord) {
+  for (int i = 0; i < n; ++i) {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) < 0) {
+      perror("socketpair");
+      return false;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      return false;
+    }
+    if (pid == 0) {
+      close(sv[0]);
+      for (LineSocket &w : coord.workers)
+        w.close_fd();
+      LineSocket conn(sv[1]);
+      DistributedWorker worker;
+      worker.serve(conn);
+      _exit(0);
+    }
+    close(sv[1]);
+    coord.workers.emplace_back(sv[0]);
+    local_pids.push_back(pid);
+  }
+  return true;
+}
+
+static void shutdown_workers(Coordinator &coord) {
+  coord.quit();
+  for (pid_t pid : local_pids)
+    waitpid(pid, nullptr, 0);
+  local_pids.clear();
+}
+
+static int run_worker(const string &addr) {
+  int listen_fd = open_socket(addr, true);
+  if (listen_fd < 0)
+    return 1;
+  cerr << "worker listening on " << addr << endl;
+  while (true) {
+    int fd = accept_connection(listen_fd);
+    if (fd < 0) {
+      perror("accept");
+      return 1;
+    }
+    LineSocket conn(fd);
+    DistributedWorker worker;
+    worker.serve(conn);
+  }
+}
+
+static int run_search(int argc, char **argv) {
+  vector<string> remote;
+  int local = 0, sync_ms = 50;
+  double seconds = 1.0;
+  vector<pair<int, int>> moves;
+  for (int i = 2; i + 1 < argc; i += 2) {
+    string flag = argv[i], value = argv[i + 1];
+    if (flag == "--workers") {
+      stringstream list(value);
+      string addr;
+      while (getline(list, addr, ','))
+        remote.push_back(addr);
+    } else if (flag == "--local") {
+      local = atoi(value.c_str());
+    } else if (flag == "--time") {
+      seconds = atof(value.c_str());
+    } else if (flag == "--sync") {
+      sync_ms = atoi(value.c_str());
+    } else if (flag == "--moves") {
+      istringstream in(value);
+      vector<int> rc;
+      for (int x; in >> x;)
+        rc.push_back(x);
+      if (!in.eof() || rc.size() % 2) {
+        cerr << "bad --moves: " << value << endl;
+        return 2;
+      }
+      State st;
+      for (size_t k = 0; k < rc.size(); k += 2) {
+        pair<int, int> mv{rc[k], rc[k + 1]};
+        if (!is_legal_move(st, mv)) {
+          cerr << "illegal move " << mv.first << " " << mv.second << endl;
+          return 2;
+        }
+        st.apply_move(mv);
+        moves.push_back(mv);
+      }
+      if (st.is_terminal()) {
+        cerr << "the game is over after --moves" << endl;
+        return 2;
+      }
+    } else {
+      cerr << "unknown flag " << flag << endl;
+      return 1;
+    }
+  }
+
+  Coordinator coord;
+  for (const string &addr : remote) {
+    int fd = open_socket(addr, false);
+    if (fd < 0)
+      return 1;
+    coord.workers.emplace_back(fd);
+  }
+  if (!spawn_local_workers(local, coord) || coord.workers.empty()) {
+    cerr << "no workers" << endl;
+    return 1;
+  }
+
+  DistributedResult res;
+  bool ok = coord.search(moves, seconds, sync_ms, 560, res);
+  shutdown_workers(coord);
+  if (!ok)
+    return 1;
+  cout << "workers " << remote.size() + local << ", iterations "
+       << res.total.iterations << ", iterations/sec "
+       << static_cast<long>(res.total.iterations / res.seconds) << endl;
+  for (int cell = 0; cell < 81; ++cell)
+    if (res.total.visits[cell] > 0)
+      cout << "  " << cell / 9 << " " << cell % 9 << ": visits "
+           << static_cast<long>(res.total.visits[cell]) << ", win rate "
+           << fixed << setprecision(3)
+           << res.total.wins[cell] / res.total.visits[cell] << defaultfloat
+           << endl;
+  cout << "bestmove " << res.best_move.first << " " << res.best_move.second
+       << endl;
+  return 0;
+}
+
+static int run_scale(int max_workers, double seconds, int sync_ms) {
+  auto lines = bench_lines();
+
+  // Reference: one long search per position
+  vector<pair<int, int>> reference;
+  for (const auto &line : lines) {
+    Coordinator coord;
+    DistributedResult res;
+    if (!spawn_local_workers(1, coord) ||
+        !coord.search(line, seconds * max_workers, sync_ms, 1, res))
+      return 1;
+    shutdown_workers(coord);
+    reference.push_back(res.best_move);
+  }
+
+  cout << "workers,iterations_per_sec,agreement,best_visit_share" << endl;
+  for (int n = 1; n <= max_workers; n *= 2) {
+    long iterations = 0;
+    double elapsed = 0, share = 0;
+    int agree = 0;
+    for (size_t p = 0; p < lines.size(); ++p) {
+      Coordinator coord;
+      DistributedResult res;
+      if (!spawn_local_workers(n, coord) ||
+          !coord.search(lines[p], seconds, sync_ms, 2 + p, res))
+        return 1;
+      shutdown_workers(coord);
+      iterations += res.total.iterations;
+      elapsed += res.seconds;
+      agree += res.best_move == reference[p];
+      double sum = 0;
+      for (double v : res.total.visits)
+        sum += v;
+      int cell = res.best_move.first * 9 + res.best_move.second;
+      share += res.total.visits[cell] / sum;
+    }
+    cout << n << "," << static_cast<long>(iterations / elapsed) << ","
+         << double(agree) / lines.size() << "," << share / lines.size()
+         << endl;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  string mode = argc > 1 ? argv[1] : "";
+  if (mode == "worker" && argc > 2)
+    return run_worker(argv[2]);
+  if (mode == "search")
+    return run_search(argc, argv);
+  if (mode == "scale" && argc > 2)
+    return run_scale(atoi(argv[2]), argc > 3 ? atof(argv[3]) : 1.0,
+                     argc > 4 ? atoi(argv[4]) : 50);
+  cerr << "usage: mcts-dist worker ADDR | search [flags] | scale MAX [S] [MS]"
+       << endl;
+  return 2;
+}
@@ -0,0 +1,104 @@
+"""
+Build a single-file CodinGame submission from a bot source and the uttt/
+header library, optionally embedding binary data files.
+
+    python3 tools/amalgamate.py mcts-v2.cpp -o build/mcts-v2-submit.cpp \
+        --embed playout_policy=data/playout_policy
+
+Local '#include "..."' lines are inlined once each (headers use #pragma once);
+system includes are left in place. Each --embed NAME=PATH becomes a base-85
+string literal registered under NAME, decoded at startup by uttt/embed.h.
+Comment-only lines, blank lines and indentation are dropped to stay under
+the size limit (the tree has no raw strings or line continuations, which
+this would break); --keep-comments leaves the source as written.
+"""
+
+import argparse
+import base64
+import os
+import re
+import sys
+
+CODINGAME_LIMIT = 100_000  # characters
+LITERAL_WIDTH = 96
+
+INCLUDE_RE = re.compile(r'^\s*#\s*include\s+"([^"]+)"\s*$')
+
+
+def inline(path: str, seen: set, out: list) -> None:
+    path = os.path.normpath(path)
+    if path in seen:
+        return
+    seen.add(path)
+    out.append(f"// ---- begin {path} ----\n")
+    with open(path) as f:
+        for line in f:
+            m = INCLUDE_RE.match(line)
+            if m:
+                inline(os.path.join(os.path.dirname(path), m.group(1)), seen, out)
+            elif line.strip() != "#pragma once":
+                out.append(line)
+    out.append(f"// ---- end {path} ----\n")
+
+
+def blob_literal(var: str, data: bytes) -> str:
+    text = base64.b85encode(data).decode("ascii")
+    lines = []
+    for i in range(0, len(text), LITERAL_WIDTH):
+        # Split '??' so no compiler mode can read it as a trigraph
+        chunk = re.sub(r"\?(?=\?)", '?" "', text[i : i + LITERAL_WIDTH])
+        lines.append(f'    "{chunk}"')
+    return f"static const char {var}[] =\n" + "\n".join(lines) + ";\n"
+
+
+def minify(lines: list) -> list:
+    out = []
+    for line in lines:
+        code = line.strip()
+        if code and not code.startswith("//"):
+            out.append(code + "\n")
+    return out
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("source")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--embed", action="append", default=[], metavar="NAME=PATH")
+    parser.add_argument("--keep-comments", action="store_true")
+    args = parser.parse_args()
+
+    header = [f"// Generated by tools/amalgamate.py from {args.source}. Do not edit.\n"]
+    entries = []
+    for i, spec in enumerate(args.embed):
+        name, _, path = spec.partition("=")
+        if not name or not path:
+            parser.error(f"--embed expects NAME=PATH, got '{spec}'")
+        with open(path, "rb") as f:
+            data = f.read()
+        var = f"UTTT_BLOB_{i}"
+        header.append(blob_literal(var, data))
+        entries.append(f'{{"{name}", {len(data)}, {var}}},')
+    if entries:
+        header.append("#define UTTT_EMBEDDED_BLOBS " + " ".join(entries) + "\n")
+
+    body = []
+    inline(args.source, set(), body)
+    if not args.keep_comments:
+        body = minify("".join(body).splitlines())
+    text = "".join(header) + "".join(body)
+
+    os.makedirs(os.path.dirname(os.path.abspath(args.output)), exist_ok=True)
+    with open(args.output, "w") as f:
+        f.write(text)
+    print(f"{args.output}: {len(text)} characters, {len(entries)} embedded blobs")
+    if len(text) > CODINGAME_LIMIT:
+        print(
+            f"warning: exceeds the CodinGame limit of {CODINGAME_LIMIT} characters",
+            file=sys.stderr,
+        )
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,256 @@
+"""
+Benchmark comparator: is one build faster than another, beyond the noise?
+
+    python3 tools/bench_compare.py ./mcts-v2-old ./mcts-v2 --runs 10 \
+        [--args "bench 0.5"] [--cpu 3] [--json cmp.json] [--history bench.jsonl]
+
+Runs both builds' bench output (any mode that prints "label: metric value,
+metric value, ..." lines, bench by default) interleaved, ABBA order within
+each pair of rounds so that drift in clock speed or load falls on both
+equally, after --warmup discarded rounds. Every run is pinned to one CPU
+(the last one this process may use unless --cpu says otherwise; --cpu -1
+turns pinning off). Single runs swing by 10% or more; see
+errorstream_cpp-v2.txt.
+
+For every label (bench position) and metric, and for the per-round mean over
+all labels, it reports both means, the candidate's paired difference as a
+share of the baseline with a Student t confidence interval, and flags the
+metric when the whole interval lies on the bad side by more than
+--min-effect percent. Only metrics with a known good direction are flagged
+(iterations/sec up, bytes/node down, ...), and the flags use intervals
+widened for the number of such rows (Bonferroni), so that a build compared
+with itself is flagged anywhere with at most 1 - --confidence probability.
+The printed intervals are the unadjusted ones. The exit status is 1 if
+anything was flagged. --json writes the comparison; --history appends it as one line
+to a JSON-lines file, for tracking builds over time.
+"""
+
+import argparse
+import json
+import math
+import os
+import re
+import shlex
+import statistics
+import subprocess
+import sys
+import time
+
+LINE_RE = re.compile(r"^([\w ]+?): (.*)$")
+FIELD_RE = re.compile(r"^(.*?) (-?\d+(?:\.\d+)?(?:e[-+]?\d+)?)(?:%| \w+| \(.*\))?$")
+
+# +1: higher is better, -1: lower is better; others are reported only
+DIRECTION = {
+    "iterations/sec": 1,
+    "iterations": 1,
+    "bytes/node": -1,
+    "eval cache hits": 1,
+    "tidy": -1,
+}
+
+
+def parse_output(text: str) -> dict:
+    """{label: {metric: value}} from the "label: metric value, ..." lines."""
+    result = {}
+    for line in text.splitlines():
+        m = LINE_RE.match(line.strip())
+        if not m:
+            continue
+        metrics = {}
+        for field in m.group(2).split(", "):
+            f = FIELD_RE.match(field.strip())
+            if f:
+                metrics[f.group(1)] = float(f.group(2))
+        if metrics:
+            result[m.group(1)] = metrics
+    return result
+
+
+def run_once(cmd: list, cpu: int) -> dict:
+    def pin() -> None:
+        os.sched_setaffinity(0, {cpu})
+
+    proc = subprocess.run(
+        cmd,
+        stdout=subprocess.PIPE,
+        stderr=subprocess.DEVNULL,
+        text=True,
+        preexec_fn=pin if cpu >= 0 else None,
+    )
+    if proc.returncode != 0:
+        raise RuntimeError(f"{shlex.join(cmd)} exited with {proc.returncode}")
+    parsed = parse_output(proc.stdout)
+    if not parsed:
+        raise RuntimeError(f"{shlex.join(cmd)} printed no metrics")
+    return parsed
+
+
+def t_quantile(p: float, dof: int) -> float:
+    """Student t quantile; exact for 1 and 2 degrees of freedom, otherwise
+    the Cornish-Fisher expansion, within 0.2% from 3 up."""
+    if dof == 1:
+        return math.tan(math.pi * (p - 0.5))
+    if dof == 2:
+        return (2 * p - 1) / math.sqrt(2 * p * (1 - p))
+    z = statistics.NormalDist().inv_cdf(p)
+    n = float(dof)
+    return (
+        z
+        + (z**3 + z) / (4 * n)
+        + (5 * z**5 + 16 * z**3 + 3 * z) / (96 * n**2)
+        + (3 * z**7 + 19 * z**5 + 17 * z**3 - 15 * z) / (384 * n**3)
+        + (79 * z**9 + 776 * z**7 + 1482 * z**5 - 1920 * z**3 - 945 * z)
+        / (92160 * n**4)
+    )
+
+
+def interval(diffs: list, confidence: float) -> tuple:
+    """Confidence interval of the mean of diffs."""
+    mean = statistics.mean(diffs)
+    if len(diffs) < 2:
+        return mean, mean
+    half = (t_quantile(0.5 + confidence / 2, len(diffs) - 1) *
+            statistics.stdev(diffs) / math.sqrt(len(diffs)))
+    return mean - half, mean + half
+
+
+def compare(base: list, cand: list, confidence: float) -> dict:
+    """Paired comparison of per-round values of one metric, in percent of
+    the baseline."""
+    diffs = [c - b for b, c in zip(base, cand)]
+    base_mean = statistics.mean(base)
+    scale = 100 / base_mean if base_mean else 0.0
+    lo, hi = interval(diffs, confidence)
+    return {
+        "baseline": base_mean,
+        "candidate": statistics.mean(cand),
+        "diff_pct": statistics.mean(diffs) * scale,
+        "ci_pct": [lo * scale, hi * scale],
+        "verdict": "",
+        "diffs_pct": [d * scale for d in diffs],
+    }
+
+
+def judge(row: dict, confidence: float, min_effect: float) -> str:
+    """REGRESSION or improvement when the interval at confidence clears
+    min_effect percent on one side, "" otherwise."""
+    sign = DIRECTION.get(row["metric"], 0)
+    if not sign or len(row["diffs_pct"]) < 2 or not row["baseline"]:
+        return ""
+    # the interval of the improvement, whichever way is better
+    lo, hi = sorted(sign * x for x in interval(row["diffs_pct"], confidence))
+    if hi < -min_effect:
+        return "REGRESSION"
+    if lo > min_effect:
+        return "improvement"
+    return ""
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("baseline", help="baseline build, e.g. './mcts-v2-old'")
+    parser.add_argument("candidate", help="candidate build")
+    parser.add_argument("--args", default="bench 0.5",
+                        help="mode and options passed to both builds")
+    parser.add_argument("--runs", type=int, default=10, help="rounds measured")
+    parser.add_argument("--warmup", type=int, default=1,
+                        help="rounds run first and discarded")
+    parser.add_argument("--cpu", type=int, default=None,
+                        help="CPU to pin runs to, -1 for none")
+    parser.add_argument("--confidence", type=float, default=0.95)
+    parser.add_argument("--min-effect", type=float, default=1.0,
+                        help="smallest change in percent worth flagging")
+    parser.add_argument("--json", help="write the comparison here")
+    parser.add_argument("--history", help="append the comparison to this file")
+    args = parser.parse_args()
+
+    cpu = args.cpu
+    if cpu is None:
+        cpu = max(os.sched_getaffinity(0))
+    extra = shlex.split(args.args)
+    cmds = {
+        "baseline": shlex.split(args.baseline) + extra,
+        "candidate": shlex.split(args.candidate) + extra,
+    }
+    samples = {"baseline": [], "candidate": []}
+    try:
+        for k in range(args.warmup + args.runs):
+            order = ["baseline", "candidate"]
+            if k % 2:
+                order.reverse()
+            for name in order:
+                out = run_once(cmds[name], cpu)
+                if k >= args.warmup:
+                    samples[name].append(out)
+            if k >= args.warmup:
+                print(f"round {k - args.warmup + 1}/{args.runs}", end="\r",
+                      file=sys.stderr, flush=True)
+    except (OSError, RuntimeError) as e:
+        print(f"error: {e}", file=sys.stderr)
+        return 2
+    print(file=sys.stderr)
+
+    labels = [l for l in samples["baseline"][0] if l in samples["candidate"][0]]
+    rows = []
+    summary = {}  # metric -> per-round means over the labels
+    for label in labels:
+        metrics = samples["baseline"][0][label].keys()
+        for metric in metrics:
+            try:
+                base = [s[label][metric] for s in samples["baseline"]]
+                cand = [s[label][metric] for s in samples["candidate"]]
+            except KeyError:
+                continue  # not printed by every run
+            r = compare(base, cand, args.confidence)
+            rows.append(dict(label=label, metric=metric, **r))
+            per_round = summary.setdefault(metric, ([0.0] * args.runs,
+                                                    [0.0] * args.runs, [0]))
+            for i in range(args.runs):
+                per_round[0][i] += base[i]
+                per_round[1][i] += cand[i]
+            per_round[2][0] += 1
+    for metric, (base, cand, count) in summary.items():
+        if count[0] > 1:
+            base = [v / count[0] for v in base]
+            cand = [v / count[0] for v in cand]
+            r = compare(base, cand, args.confidence)
+            rows.append(dict(label="mean", metric=metric, **r))
+    # Bonferroni: all verdicts together are wrong with at most 1 - confidence
+    tested = max(1, sum(r["metric"] in DIRECTION for r in rows))
+    for r in rows:
+        r["verdict"] = judge(r, 1 - (1 - args.confidence) / tested,
+                             args.min_effect)
+
+    width = max(len(f"{r['label']} {r['metric']}") for r in rows)
+    print(f"{'':{width}}  {'baseline':>12} {'candidate':>12} {'diff':>8}  "
+          f"{int(args.confidence * 100)}% CI")
+    for r in rows:
+        lo, hi = r["ci_pct"]
+        print(f"{r['label'] + ' ' + r['metric']:{width}}  {r['baseline']:12.6g} "
+              f"{r['candidate']:12.6g} {r['diff_pct']:+7.2f}%  "
+              f"[{lo:+.2f}%, {hi:+.2f}%] {r['verdict']}")
+
+    result = {
+        "time": time.strftime("%Y-%m-%dT%H:%M:%S"),
+        "baseline": args.baseline,
+        "candidate": args.candidate,
+        "args": args.args,
+        "runs": args.runs,
+        "warmup": args.warmup,
+        "cpu": cpu,
+        "confidence": args.confidence,
+        "min_effect_pct": args.min_effect,
+        "rows": rows,
+        "regressions": sum(r["verdict"] == "REGRESSION" for r in rows),
+    }
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(result, f, indent=2)
+    if args.history:
+        with open(args.history, "a") as f:
+            f.write(json.dumps(result) + "\n")
+    return 1 if result["regressions"] else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,377 @@
+"""
+Host density benchmark: how many concurrent bot instances a machine carries.
+
+    python3 tools/density.py ./mcts-v2 --instances 2,4,8,16 --seconds 60 \
+        [--json density.json] [--bandwidth-probe]
+
+For every level N, N bot processes play N/2 games against each other under
+a local referee with CodinGame timing (1 s for the first answer, 0.1 s
+after that), starting new games until the level's time is up. Reported per
+level:
+- iterations per move, from the stats line the bot writes to stderr after
+  every answer (the per-instance mean and the spread across instances)
+- answer latency percentiles and deadline misses, first turns excluded
+  from the percentiles but not from the misses. A bot that has not
+  answered READ_MARGIN seconds after its limit counts as a miss and its
+  game is abandoned; the other games go on
+- peak RSS per instance (VmHWM from /proc)
+- memory bandwidth: host-wide from the resctrl MBM counters when the
+  kernel exposes them; otherwise, with --bandwidth-probe, the copy rate a
+  separate probe process still gets while the bots run, next to its rate
+  on an idle host. The probe takes a core of its own.
+The referee measures latency from writing the turn to reading the answer,
+so referee scheduling delays count against the bot, as they would on a
+ladder host running its own referee.
+"""
+
+import argparse
+import glob
+import json
+import os
+import re
+import selectors
+import shlex
+import statistics
+import subprocess
+import sys
+import threading
+import time
+
+LINES = [0x7, 0x38, 0x1C0, 0x49, 0x92, 0x124, 0x111, 0x54]
+STATS_RE = re.compile(r"^\w+: iterations (\d+),")
+READ_MARGIN = 0.5  # seconds past the turn limit before an answer is given up
+
+
+def is_win(mask: int) -> bool:
+    return any(mask & w == w for w in LINES)
+
+
+class Game:
+    """CodinGame rules, including the sub-board count on a full board."""
+
+    def __init__(self) -> None:
+        self.x = [0] * 9
+        self.o = [0] * 9
+        self.meta_x = self.meta_o = self.meta_d = 0
+        self.target = 9
+        self.x_to_move = True
+        self.winner = 0  # 1 = X, -1 = O, 2 = draw
+
+    def moves(self) -> list:
+        closed = self.meta_x | self.meta_o | self.meta_d
+        boards = [self.target]
+        if self.target == 9 or (closed >> self.target) & 1:
+            boards = [b for b in range(9) if not (closed >> b) & 1]
+        return [
+            ((b // 3) * 3 + i // 3, (b % 3) * 3 + i % 3)
+            for b in boards
+            for i in range(9)
+            if not ((self.x[b] | self.o[b]) >> i) & 1
+        ]
+
+    def play(self, r: int, c: int) -> None:
+        b, p = (r // 3) * 3 + c // 3, (r % 3) * 3 + c % 3
+        side = self.x if self.x_to_move else self.o
+        side[b] |= 1 << p
+        if not ((self.meta_x | self.meta_o | self.meta_d) >> b) & 1:
+            if is_win(self.x[b]):
+                self.meta_x |= 1 << b
+            elif is_win(self.o[b]):
+                self.meta_o |= 1 << b
+            elif self.x[b] | self.o[b] == 0x1FF:
+                self.meta_d |= 1 << b
+        closed = self.meta_x | self.meta_o | self.meta_d
+        if is_win(self.meta_x):
+            self.winner = 1
+        elif is_win(self.meta_o):
+            self.winner = -1
+        elif closed == 0x1FF:
+            nx, no = bin(self.meta_x).count("1"), bin(self.meta_o).count("1")
+            self.winner = 1 if nx > no else -1 if no > nx else 2
+        self.target = 9 if (closed >> p) & 1 else p
+        self.x_to_move = not self.x_to_move
+
+
+class Bot:
+    """One bot process; stderr is drained by a thread so it never blocks."""
+
+    def __init__(self, cmd: list) -> None:
+        self.proc = subprocess.Popen(
+            cmd,
+            stdin=subprocess.PIPE,
+            stdout=subprocess.PIPE,
+            stderr=subprocess.PIPE,
+            text=True,
+        )
+        self.iterations = []
+        self.reader = threading.Thread(target=self._drain, daemon=True)
+        self.reader.start()
+        # stdout is read from the raw pipe so that select sees every byte
+        self.pending = b""
+        self.selector = selectors.DefaultSelector()
+        self.selector.register(self.proc.stdout.fileno(), selectors.EVENT_READ)
+
+    def _drain(self) -> None:
+        for line in self.proc.stderr:
+            m = STATS_RE.match(line)
+            if m:
+                self.iterations.append(int(m.group(1)))
+
+    def read_line(self, timeout: float):
+        """Next stdout line, "" once stdout is closed, None if no line came
+        within timeout seconds."""
+        end = time.perf_counter() + timeout
+        while b"\n" not in self.pending:
+            left = end - time.perf_counter()
+            if left <= 0 or not self.selector.select(left):
+                return None
+            chunk = os.read(self.proc.stdout.fileno(), 4096)
+            if not chunk:
+                return ""
+            self.pending += chunk
+        line, _, self.pending = self.pending.partition(b"\n")
+        return line.decode()
+
+    def peak_rss_kb(self) -> int:
+        try:
+            with open(f"/proc/{self.proc.pid}/status") as f:
+                for line in f:
+                    if line.startswith("VmHWM:"):
+                        return int(line.split()[1])
+        except OSError:
+            pass
+        return 0
+
+    def close(self, kill: bool = False) -> None:
+        self.selector.close()
+        if kill:
+            self.proc.kill()
+        try:
+            self.proc.stdin.close()
+            self.proc.wait(timeout=5)
+        except (OSError, subprocess.TimeoutExpired):
+            self.proc.kill()
+            self.proc.wait()
+        self.reader.join(timeout=5)
+
+
+class Level:
+    """Everything measured at one instance count."""
+
+    def __init__(self) -> None:
+        self.lock = threading.Lock()
+        self.games = 0
+        self.latencies = []  # seconds, turns after the first
+        self.misses = 0
+        self.answers = 0
+        self.iterations = []  # mean iterations per move, one per instance
+        self.all_iterations = []
+        self.rss_kb = []
+        self.errors = []
+
+
+def play_games(cmd: list, deadline: float, limits: tuple, level: Level) -> None:
+    """Plays games between two fresh bots until the deadline passes."""
+    while time.monotonic() < deadline:
+        bots = [Bot(cmd), Bot(cmd)]
+        game = Game()
+        last = (-1, -1)
+        turns = [0, 0]
+        latencies, misses, error, hung = [], 0, None, None
+        try:
+            while not game.winner:
+                i = 0 if game.x_to_move else 1
+                moves = game.moves()
+                text = f"{last[0]} {last[1]}\n{len(moves)}\n"
+                text += "".join(f"{r} {c}\n" for r, c in moves)
+                bots[i].proc.stdin.write(text)
+                start = time.perf_counter()
+                bots[i].proc.stdin.flush()
+                limit = limits[0] if turns[i] == 0 else limits[1]
+                answer = bots[i].read_line(limit + READ_MARGIN)
+                elapsed = time.perf_counter() - start
+                if answer is None:
+                    misses += 1
+                    turns[i] += 1
+                    hung = bots[i]
+                    error = f"no answer within {limit + READ_MARGIN:.2f} s"
+                    break
+                r, c = map(int, answer.split())
+                if (r, c) not in moves:
+                    raise ValueError(f"illegal move {r} {c}")
+                misses += elapsed > limit
+                if turns[i]:
+                    latencies.append(elapsed)
+                turns[i] += 1
+                game.play(r, c)
+                last = (r, c)
+        except (ValueError, OSError) as e:
+            error = str(e) or type(e).__name__
+        rss = [b.peak_rss_kb() for b in bots]
+        for b in bots:
+            b.close(kill=b is hung)
+        with level.lock:
+            level.games += 1
+            level.latencies += latencies
+            level.misses += misses
+            level.answers += sum(turns)
+            for b, kb in zip(bots, rss):
+                if b.iterations:
+                    level.iterations.append(statistics.mean(b.iterations))
+                    level.all_iterations += b.iterations
+                if kb:
+                    level.rss_kb.append(kb)
+            if error:
+                level.errors.append(error)
+
+
+def mbm_total_bytes():
+    """Host memory traffic so far from resctrl MBM, None if unavailable."""
+    files = glob.glob("/sys/fs/resctrl/mon_data/*/mbm_total_bytes")
+    if not files:
+        return None
+    total = 0
+    for path in files:
+        try:
+            with open(path) as f:
+                total += int(f.read())
+        except (OSError, ValueError):
+            return None
+    return total
+
+
+PROBE = """
+import sys, time
+import numpy as np
+a = np.ones(8 << 20); b = np.empty_like(a)
+end = time.monotonic() + float(sys.argv[1]); moved = 0; start = time.monotonic()
+while time.monotonic() < end:
+    np.copyto(b, a); moved += 2 * a.nbytes
+print(moved / (time.monotonic() - start) / 1e9)
+"""
+
+
+def start_probe(seconds: float):
+    """Copy-loop process reporting GB/s when it ends, None without numpy."""
+    try:
+        return subprocess.Popen(
+            [sys.executable, "-c", PROBE, str(seconds)],
+            stdout=subprocess.PIPE,
+            stderr=subprocess.DEVNULL,
+            text=True,
+        )
+    except OSError:
+        return None
+
+
+def probe_result(proc):
+    if proc is None:
+        return None
+    out, _ = proc.communicate()
+    try:
+        return float(out)
+    except ValueError:
+        return None
+
+
+def percentile(values: list, q: float) -> float:
+    if not values:
+        return 0.0
+    values = sorted(values)
+    return values[min(len(values) - 1, int(q * len(values)))]
+
+
+def run_level(cmd: list, instances: int, seconds: float, limits: tuple,
+              probe: bool) -> dict:
+    level = Level()
+    deadline = time.monotonic() + seconds
+    mbm_before, t0 = mbm_total_bytes(), time.monotonic()
+    prober = start_probe(seconds) if probe else None
+    threads = [
+        threading.Thread(target=play_games, args=(cmd, deadline, limits, level))
+        for _ in range(max(1, instances // 2))
+    ]
+    for t in threads:
+        t.start()
+    for t in threads:
+        t.join()
+    mbm_after, t1 = mbm_total_bytes(), time.monotonic()
+    per_instance = level.iterations
+    result = {
+        "instances": 2 * len(threads),
+        "games": level.games,
+        "answers": level.answers,
+        "misses": level.misses,
+        "miss_rate": level.misses / level.answers if level.answers else 0.0,
+        "iterations_per_move": statistics.mean(level.all_iterations)
+        if level.all_iterations
+        else 0.0,
+        "instance_iterations_min": min(per_instance) if per_instance else 0.0,
+        "instance_iterations_max": max(per_instance) if per_instance else 0.0,
+        "latency_ms": {
+            name: 1000 * percentile(level.latencies, q)
+            for name, q in (("p50", 0.5), ("p90", 0.9), ("p99", 0.99),
+                            ("max", 1.0))
+        },
+        "peak_rss_mb": max(level.rss_kb) / 1024 if level.rss_kb else 0.0,
+        "mean_rss_mb": statistics.mean(level.rss_kb) / 1024
+        if level.rss_kb
+        else 0.0,
+        "errors": level.errors[:5],
+    }
+    if mbm_before is not None and mbm_after is not None:
+        result["host_bandwidth_gbs"] = (mbm_after - mbm_before) / (t1 - t0) / 1e9
+    if prober is not None:
+        result["probe_bandwidth_gbs"] = probe_result(prober)
+    return result
+
+
+def print_level(r: dict) -> None:
+    lat = r["latency_ms"]
+    line = (
+        f"{r['instances']:4d} instances: {r['games']} games, iterations/move "
+        f"{r['iterations_per_move']:.0f} (instances "
+        f"{r['instance_iterations_min']:.0f}-{r['instance_iterations_max']:.0f}), "
+        f"latency p50 {lat['p50']:.1f} p90 {lat['p90']:.1f} p99 {lat['p99']:.1f} "
+        f"max {lat['max']:.1f} ms, misses {r['misses']}/{r['answers']}, "
+        f"RSS {r['mean_rss_mb']:.0f} MB (peak {r['peak_rss_mb']:.0f})"
+    )
+    if "host_bandwidth_gbs" in r:
+        line += f", host bandwidth {r['host_bandwidth_gbs']:.2f} GB/s"
+    if r.get("probe_bandwidth_gbs") is not None:
+        line += f", probe bandwidth {r['probe_bandwidth_gbs']:.2f} GB/s"
+    print(line, flush=True)
+    for e in r["errors"]:
+        print(f"    error: {e}", flush=True)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("bot", help="bot command line, e.g. './mcts-v2 --prior 2'")
+    parser.add_argument("--instances", default="2,4,8", help="even bot counts")
+    parser.add_argument("--seconds", type=float, default=30.0, help="per level")
+    parser.add_argument("--first-turn", type=float, default=1.0)
+    parser.add_argument("--turn", type=float, default=0.1)
+    parser.add_argument("--bandwidth-probe", action="store_true")
+    parser.add_argument("--json", help="write the results here")
+    args = parser.parse_args()
+
+    cmd = shlex.split(args.bot)
+    levels = [int(n) for n in args.instances.split(",")]
+    results = {"bot": args.bot, "cpus": os.cpu_count(), "levels": []}
+    if args.bandwidth_probe:
+        results["idle_probe_bandwidth_gbs"] = probe_result(start_probe(3.0))
+        print(f"idle probe bandwidth {results['idle_probe_bandwidth_gbs']} GB/s")
+    for n in levels:
+        r = run_level(cmd, n, args.seconds, (args.first_turn, args.turn),
+                      args.bandwidth_probe)
+        results["levels"].append(r)
+        print_level(r)
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(results, f, indent=2)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
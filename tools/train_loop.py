@@ -0,0 +1,271 @@
+"""
+Generate-train-gate loop for the playout policy.
+
+    python3 tools/train_loop.py ./mcts-v2 --dir loop --generations 10 \
+        [--games 400] [--iterations 2000] [--window 4] [--gate-games 200] \
+        [--gate-iterations 1000] [--workers N] [--init data/playout_policy] \
+        [--publish data/playout_policy]
+
+Each generation runs three stages through the bot's own modes:
+1. selfplay: --games games with the incumbent weights, split over --workers
+   processes (one per CPU by default), into DIR/games/gen-NNNN.txt. Before
+   the first promotion the incumbent is --init, or uniform playouts.
+2. train: train-policy on the games of the last --window generations,
+   starting from the incumbent, into DIR/weights/cand-NNNN.
+3. gate: arena between the candidate and the incumbent, with a fixed number
+   of iterations per move so that the result does not depend on the load,
+   also split over the workers. The candidate is promoted if its score is
+   above 0.5 with one-sided --gate-confidence; with --publish the promoted
+   weights are also copied there.
+DIR/state.json records the incumbent and the next stage after every stage,
+so an interrupted loop resumes where it stopped; stages write under
+temporary names first, so a stage cut short is simply run again. Every stage
+logs its duration and throughput (games/s, positions/s) to the console and
+to DIR/log.jsonl.
+"""
+
+import argparse
+import json
+import os
+import shlex
+import shutil
+import statistics
+import subprocess
+import sys
+import time
+
+STAGES = ["selfplay", "train", "gate"]
+
+
+def split(total: int, parts: int, multiple: int = 1) -> list:
+    """total in at most parts non-empty chunks, each a multiple of multiple."""
+    units = total // multiple
+    parts = max(1, min(parts, units))
+    return [multiple * (units // parts + (k < units % parts))
+            for k in range(parts)]
+
+
+def run_all(cmds: list, label: str) -> list:
+    """Runs the commands in parallel; (stdout, stderr) of each, or exits on
+    a failure."""
+    procs = [subprocess.Popen(c, stdout=subprocess.PIPE, stderr=subprocess.PIPE,
+                              text=True) for c in cmds]
+    outputs = []
+    failed = None
+    for c, p in zip(cmds, procs):
+        out, err = p.communicate()
+        if p.returncode != 0 and failed is None:
+            failed = f"{label}: {shlex.join(c)} exited with {p.returncode}\n{err}"
+        outputs.append((out, err))
+    if failed:
+        sys.exit(failed)
+    return outputs
+
+
+def policy_flags(weights) -> list:
+    return ["--policy-file", weights] if weights else ["--playout", "uniform"]
+
+
+def record_counts(path: str) -> tuple:
+    """(games, positions) in a record file."""
+    games = positions = 0
+    with open(path) as f:
+        for line in f:
+            if line.strip() and not line.startswith("#"):
+                games += 1
+                positions += len(line.split()) - 1
+    return games, positions
+
+
+class Loop:
+    def __init__(self, args) -> None:
+        self.args = args
+        self.bot = shlex.split(args.bot)
+        self.dir = args.dir
+        for sub in ("games", "weights"):
+            os.makedirs(os.path.join(self.dir, sub), exist_ok=True)
+        self.state_path = os.path.join(self.dir, "state.json")
+        if os.path.exists(self.state_path):
+            with open(self.state_path) as f:
+                self.state = json.load(f)
+            print(f"resuming at generation {self.state['generation']}, "
+                  f"{self.state['stage']}", flush=True)
+        else:
+            incumbent = None
+            if args.init:
+                incumbent = os.path.join(self.dir, "weights", "init")
+                shutil.copyfile(args.init, incumbent)
+            self.state = {"generation": 1, "stage": "selfplay",
+                          "incumbent": incumbent, "promotions": []}
+            self.save()
+
+    def save(self) -> None:
+        tmp = self.state_path + ".tmp"
+        with open(tmp, "w") as f:
+            json.dump(self.state, f, indent=2)
+        os.replace(tmp, self.state_path)
+
+    def log(self, entry: dict) -> None:
+        entry = {"time": time.strftime("%Y-%m-%dT%H:%M:%S"), **entry}
+        with open(os.path.join(self.dir, "log.jsonl"), "a") as f:
+            f.write(json.dumps(entry) + "\n")
+        text = ", ".join(f"{k} {v:.4g}" if isinstance(v, float) else f"{k} {v}"
+                         for k, v in entry.items()
+                         if k not in ("time", "generation", "stage"))
+        print(f"gen {entry['generation']} {entry['stage']}: {text}", flush=True)
+
+    def games_path(self, gen: int) -> str:
+        return os.path.join(self.dir, "games", f"gen-{gen:04d}.txt")
+
+    def cand_path(self, gen: int) -> str:
+        return os.path.join(self.dir, "weights", f"cand-{gen:04d}")
+
+    def selfplay(self, gen: int) -> dict:
+        a = self.args
+        out = self.games_path(gen)
+        chunks = split(a.games, a.workers)
+        parts = [f"{out}.part{k}" for k in range(len(chunks))]
+        for p in parts:
+            if os.path.exists(p):
+                os.remove(p)  # selfplay appends
+        cmds = [self.bot + ["selfplay", str(n), "--out", p,
+                            "--iterations", str(a.iterations),
+                            "--random-plies", str(a.random_plies),
+                            "--seed", str(gen * 1000 + k)]
+                + policy_flags(self.state["incumbent"])
+                for k, (n, p) in enumerate(zip(chunks, parts))]
+        start = time.monotonic()
+        run_all(cmds, "selfplay")
+        seconds = time.monotonic() - start
+        with open(out + ".tmp", "w") as f:
+            for p in parts:
+                with open(p) as part:
+                    shutil.copyfileobj(part, f)
+                os.remove(p)
+        os.replace(out + ".tmp", out)
+        games, positions = record_counts(out)
+        return {"seconds": seconds, "workers": len(cmds), "games": games,
+                "games_per_sec": games / seconds,
+                "positions_per_sec": positions / seconds}
+
+    def train(self, gen: int) -> dict:
+        a = self.args
+        window = [self.games_path(g)
+                  for g in range(max(1, gen - a.window + 1), gen + 1)]
+        cand = self.cand_path(gen)
+        cmd = self.bot + ["train-policy", *window, "--out", cand + ".tmp",
+                          "--epochs", str(a.epochs),
+                          "--skip-plies", str(a.random_plies),
+                          "--seed", str(gen)]
+        if self.state["incumbent"]:
+            cmd += ["--init", self.state["incumbent"]]
+        start = time.monotonic()
+        [(out, err)] = run_all([cmd], "train")
+        seconds = time.monotonic() - start
+        os.replace(cand + ".tmp", cand)
+        entry = {"seconds": seconds, "window": len(window)}
+        # "N games, T training and H holdout positions, ..." on stderr
+        for line in err.splitlines():
+            words = line.replace(",", "").split()
+            if len(words) > 4 and words[1] == "games" and words[3] == "training":
+                entry["positions"] = int(words[2])
+                entry["positions_per_sec"] = (int(words[2]) * a.epochs /
+                                              seconds)
+        # "holdout loss L (uniform U), accuracy A, ..." on stdout
+        for line in out.splitlines():
+            words = line.replace(",", "").replace("(", "").split()
+            if words[:2] == ["holdout", "loss"]:
+                entry["holdout_loss"] = float(words[2])
+                entry["uniform_loss"] = float(words[4].rstrip(")"))
+                entry["accuracy"] = float(words[6])
+        return entry
+
+    def gate(self, gen: int) -> dict:
+        a = self.args
+        cand = self.cand_path(gen)
+        chunks = split(a.gate_games, a.workers, 2)  # colour-swapped pairs
+        cmds = [self.bot + ["arena", str(n),
+                            "--a", shlex.join(policy_flags(cand)),
+                            "--b", shlex.join(policy_flags(self.state["incumbent"])),
+                            "--iterations", str(a.gate_iterations),
+                            "--random-plies", str(a.random_plies),
+                            "--seed", str(gen * 1000 + 2 * k + 1)]
+                for k, n in enumerate(chunks)]
+        start = time.monotonic()
+        outputs = run_all(cmds, "gate")
+        seconds = time.monotonic() - start
+        wins = draws = losses = 0
+        for out, _ in outputs:
+            # "games N, A wins W, draws D, B wins L, A score ..."
+            for line in out.splitlines():
+                words = line.replace(",", "").split()
+                if words[:1] == ["games"] and len(words) > 9:
+                    wins += int(words[4])
+                    draws += int(words[6])
+                    losses += int(words[9])
+        n = wins + draws + losses
+        if n == 0:
+            sys.exit("gate: no arena results")
+        score = (wins + 0.5 * draws) / n
+        var = max(0.0, (wins + 0.25 * draws) / n - score * score)
+        z = statistics.NormalDist().inv_cdf(a.gate_confidence)
+        lower = score - z * (var / n) ** 0.5
+        promoted = lower > 0.5
+        if promoted:
+            self.state["incumbent"] = cand
+            self.state["promotions"].append(gen)
+            if a.publish:
+                shutil.copyfile(cand, a.publish + ".tmp")
+                os.replace(a.publish + ".tmp", a.publish)
+        return {"seconds": seconds, "games": n, "games_per_sec": n / seconds,
+                "wins": wins, "draws": draws, "losses": losses,
+                "score": score, "lower_bound": lower,
+                "promoted": promoted}
+
+    def run(self) -> None:
+        while self.state["generation"] <= self.args.generations:
+            gen, stage = self.state["generation"], self.state["stage"]
+            entry = getattr(self, stage)(gen)
+            self.log({"generation": gen, "stage": stage, **entry})
+            nxt = STAGES.index(stage) + 1
+            if nxt == len(STAGES):
+                self.state["generation"] = gen + 1
+                nxt = 0
+            self.state["stage"] = STAGES[nxt]
+            self.save()
+        print(f"incumbent {self.state['incumbent']}, promoted in generations "
+              f"{self.state['promotions']}", flush=True)
+
+
+def main() -> int:
+    parser = argparse.ArgumentParser(description=__doc__.strip().splitlines()[0])
+    parser.add_argument("bot", help="bot command line, e.g. './mcts-v2'")
+    parser.add_argument("--dir", default="loop", help="games, weights, state")
+    parser.add_argument("--generations", type=int, default=10,
+                        help="stop after this generation (total, not more)")
+    parser.add_argument("--games", type=int, default=400, help="per generation")
+    parser.add_argument("--iterations", type=int, default=2000,
+                        help="per self-play move")
+    parser.add_argument("--random-plies", type=int, default=2)
+    parser.add_argument("--window", type=int, default=4,
+                        help="generations of games trained on")
+    parser.add_argument("--epochs", type=int, default=8)
+    parser.add_argument("--gate-games", type=int, default=200)
+    parser.add_argument("--gate-iterations", type=int, default=1000,
+                        help="per arena move")
+    parser.add_argument("--gate-confidence", type=float, default=0.95)
+    parser.add_argument("--workers", type=int, default=os.cpu_count() or 1)
+    parser.add_argument("--init", help="starting weights, uniform if none")
+    parser.add_argument("--publish", help="copy promoted weights here")
+    args = parser.parse_args()
+    try:
+        Loop(args).run()
+    except KeyboardInterrupt:
+        print("\ninterrupted; run again with the same --dir to resume",
+              file=sys.stderr)
+        return 130
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
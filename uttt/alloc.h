@@ -0,0 +1,106 @@
+#pragma once
+// Heap allocation accounting per search phase.
+//
+// Built with -DUTTT_COUNT_ALLOCS, this header replaces the global operator
+// new and delete with counting versions and charges every allocation to the
+// phase set by the innermost AllocScope on the calling thread. Without the
+// flag AllocScope is an empty object and nothing is counted. The
+// replacement operators are ordinary definitions, so in a counting build
+// the header must be included by exactly one translation unit, as it is by
+// mcts-v2.cpp.
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <ostream>
+
+using namespace std;
+
+enum AllocPhase {
+  ALLOC_OTHER = 0, // outside the tree search
+  ALLOC_SELECT,
+  ALLOC_EXPAND,
+  ALLOC_SIMULATE,
+  ALLOC_BACKPROP,
+  NUM_ALLOC_PHASES
+};
+
+static const char *const ALLOC_PHASE_NAMES[NUM_ALLOC_PHASES] = {
+    "other", "select", "expand", "simulate", "backprop"};
+
+// Allocation totals per phase at one point in time
+struct AllocCounts {
+  array<long, NUM_ALLOC_PHASES> count{}, bytes{};
+
+  AllocCounts operator-(const AllocCounts &o) const {
+    AllocCounts d;
+    for (int p = 0; p < NUM_ALLOC_PHASES; ++p) {
+      d.count[p] = count[p] - o.count[p];
+      d.bytes[p] = bytes[p] - o.bytes[p];
+    }
+    return d;
+  }
+};
+
+#ifdef UTTT_COUNT_ALLOCS
+
+static const bool COUNTING_ALLOCS = true;
+
+inline thread_local AllocPhase alloc_phase = ALLOC_OTHER;
+inline array<atomic<long>, NUM_ALLOC_PHASES> alloc_count{}, alloc_bytes{};
+
+struct AllocScope {
+  AllocPhase saved;
+  explicit AllocScope(AllocPhase phase) : saved(alloc_phase) {
+    alloc_phase = phase;
+  }
+  ~AllocScope() { alloc_phase = saved; }
+};
+
+inline AllocCounts alloc_counts() {
+  AllocCounts c;
+  for (int p = 0; p < NUM_ALLOC_PHASES; ++p) {
+    c.count[p] = alloc_count[p].load(memory_order_relaxed);
+    c.bytes[p] = alloc_bytes[p].load(memory_order_relaxed);
+  }
+  return c;
+}
+
+void *operator new(size_t size) {
+  alloc_count[alloc_phase].fetch_add(1, memory_order_relaxed);
+  alloc_bytes[alloc_phase].fetch_add(size, memory_order_relaxed);
+  if (void *p = malloc(size ? size : 1))
+    return p;
+  throw bad_alloc();
+}
+
+// Out of line, or GCC sees free() paired with new at inlined call sites
+__attribute__((noinline)) void operator delete(void *p) noexcept { free(p); }
+__attribute__((noinline)) void operator delete(void *p, size_t) noexcept {
+  free(p);
+}
+
+#else
+
+static const bool COUNTING_ALLOCS = false;
+
+struct AllocScope {
+  explicit AllocScope(AllocPhase) {}
+};
+
+inline AllocCounts alloc_counts() { return AllocCounts(); }
+
+#endif
+
+// ", allocs select N (B bytes), ..." for the phases that allocated;
+// prints nothing unless allocations are counted
+inline void print_allocs(ostream &out, const AllocCounts &d) {
+  if (!COUNTING_ALLOCS)
+    return;
+  out << ", allocs";
+  for (int p = 0; p < NUM_ALLOC_PHASES; ++p)
+    out << (p ? ", " : " ") << ALLOC_PHASE_NAMES[p] << " " << d.count[p]
+        << " (" << d.bytes[p] << " B)";
+}
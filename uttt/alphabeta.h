@@ -0,0 +1,146 @@
+#pragma once
+// Iterative-deepening alpha-beta search over the bitboard State.
+//
+// The C++ successor of minimax-v1.py and minimax-v2.py: instead of solving
+// the current sub-board in isolation it searches the whole game, scores the
+// horizon with the local-game evaluation (through the shared evaluation
+// cache) and orders moves with the one-ply heuristic.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "evalcache.h"
+#include "heuristic.h"
+#include "searcher.h"
+#include "state.h"
+
+// Won positions score WIN_SCORE minus the ply they are reached at, so any
+// score beyond PROVEN_SCORE is a forced result within the search depth.
+static const double WIN_SCORE = 1000.0;
+static const double PROVEN_SCORE = 500.0;
+
+struct AlphaBetaSearcher : Searcher {
+  // Root moves with their score for the side to move, best first. Only the
+  // best score is exact; the others are upper bounds.
+  vector<pair<pair<int, int>, double>> root_moves;
+  int max_depth = 81;
+  long visited = 0;
+  bool aborted = false;
+  SearchBudget *budget = nullptr;
+
+  const char *name() const override { return "alphabeta"; }
+
+  void set_position(const State &st) override {
+    root = st;
+    root_moves.clear();
+    last = SearchStats();
+  }
+
+  void search(const SearchLimits &limits) override {
+    stopping.store(false, memory_order_relaxed);
+    SearchBudget b(limits, stopping);
+    budget = &b;
+    visited = 0;
+    aborted = false;
+    last = SearchStats();
+    if (root_moves.empty() && !root.is_terminal())
+      for (const auto &mv : root.get_valid_moves())
+        root_moves.push_back({mv, 0.0});
+
+    for (int depth = 1; depth <= max_depth && !root_moves.empty(); ++depth) {
+      auto scored = root_moves;
+      const double inf = numeric_limits<double>::infinity();
+      double alpha = -inf;
+      for (auto &entry : scored) {
+        State next = root.copy();
+        next.apply_move(entry.first);
+        entry.second = -negamax(next, depth - 1, -inf, -alpha, 1);
+        if (aborted)
+          break;
+        alpha = max(alpha, entry.second);
+      }
+      if (aborted)
+        break; // keep the last completed depth
+      auto by_score = [](const auto &a, const auto &b) {
+        return a.second > b.second;
+      };
+      stable_sort(scored.begin(), scored.end(), by_score);
+      root_moves = scored;
+      last.depth = depth;
+      last.iterations = visited;
+      // Only a proved result says how the game ends
+      double best = root_moves[0].second;
+      last.value = best > PROVEN_SCORE    ? 1.0
+                   : best < -PROVEN_SCORE ? 0.0
+                                          : -1.0;
+      b.publish(root_moves[0].first);
+      if (root_moves.size() == 1 || fabs(root_moves[0].second) > PROVEN_SCORE)
+        break;
+    }
+    last.iterations = visited;
+    last.seconds = b.elapsed();
+    budget = nullptr;
+  }
+
+  pair<int, int> best_move() const override {
+    if (last.depth == 0 || root_moves.empty())
+      return {-1, -1};
+    return root_moves[0].first;
+  }
+
+  // Score of a root move from the last completed depth (an upper bound
+  // unless it is the best move)
+  double score_of(const pair<int, int> &mv) const {
+    for (const auto &entry : root_moves)
+      if (entry.first == mv)
+        return entry.second;
+    return 0.0;
+  }
+
+  // Fail-soft negamax; scores are for the side to move in st
+  double negamax(const State &st, int depth, double alpha, double beta,
+                 int ply) {
+    if ((++visited & 63) == 0) {
+      budget->used = visited;
+      aborted = aborted || budget->exhausted();
+    }
+    if (aborted)
+      return 0.0;
+    int side = st.turnX ? 1 : -1;
+    if (st.is_terminal()) {
+      int w = st.get_winner();
+      return w == 0 ? 0.0 : (w == side ? WIN_SCORE - ply : ply - WIN_SCORE);
+    }
+    if (depth == 0)
+      return cached_local_eval(st) * side;
+
+    State::MoveList list;
+    st.get_valid_moves(list);
+    array<pair<int, pair<int, int>>, 81> moves; // ordering key, move
+    for (int i = 0; i < list.size(); ++i)
+      moves[i] = {heuristic_score(st, list[i]), list[i]};
+    auto end = moves.begin() + list.size();
+    sort(moves.begin(), end,
+         [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    double best = -numeric_limits<double>::infinity();
+    for (auto it = moves.begin(); it != end; ++it) {
+      const auto &entry = *it;
+      State next = st.copy();
+      next.apply_move(entry.second);
+      double v = -negamax(next, depth - 1, -beta, -alpha, ply + 1);
+      if (v > best) {
+        best = v;
+        if (v > alpha)
+          alpha = v;
+        if (alpha >= beta)
+          break;
+      }
+    }
+    return best;
+  }
+};
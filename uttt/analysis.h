@@ -0,0 +1,225 @@
+#pragma once
+// UCI-like analysis protocol for GUIs and tools, for any Searcher.
+//
+// Commands, one per line on stdin:
+//   uci                      -> id name ..., uciok
+//   isready                  -> readyok
+//   newgame                  drop everything learnt so far
+//   position startpos [moves M1 M2 ...]
+//   go [movetime MS] [iterations N] [infinite]
+//   stop                     end the running search
+//   quit
+// Moves are written as two digits, row then column (0-8), e.g. "44" for
+// the centre. A position that extends the previous one is applied as moves
+// onto the retained search (Searcher::advance), so successive requests
+// along a game reuse earlier work; anything else starts over. go searches
+// on a background thread, so stop and isready are answered while it runs.
+// Every --info-ms (default 250) it prints
+//   info time MS iterations N nodes N [depth N] [value V] nps N bestmove M
+// and at the end "bestmove M" ("bestmove none" in a finished position).
+// Malformed or illegal input is reported as "info string ..." and ignored.
+// At the end of input a search with a movetime or iterations limit runs
+// out and prints its bestmove; an infinite one is stopped.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "moves.h"
+#include "searcher.h"
+#include "state.h"
+
+struct AnalysisSession {
+  Searcher &searcher;
+  double info_ms;
+  vector<pair<int, int>> moves; // from startpos to the searcher's position
+  thread worker;
+  atomic<bool> running{false}; // worker has not printed bestmove yet
+  atomic<bool> abort{false};   // survives search() clearing its stop flag
+  bool infinite = false;       // the running search has no limit of its own
+  mutex out_mutex;             // the worker and the command loop both print
+
+  AnalysisSession(Searcher &s, double info_interval_ms)
+      : searcher(s), info_ms(info_interval_ms) {
+    searcher.set_position(State());
+  }
+
+  ~AnalysisSession() { halt(); }
+
+  void say(const string &line) {
+    lock_guard<mutex> lock(out_mutex);
+    cout << line << endl;
+  }
+
+  // Stops the running search, if any, and waits for its bestmove. The
+  // abort flag also covers a search that has not started yet.
+  void halt() {
+    if (!worker.joinable())
+      return;
+    abort = true;
+    searcher.stop();
+    worker.join();
+  }
+
+  // At the end of input: lets a search with a limit run out and print its
+  // bestmove, but stops an infinite one
+  void finish() {
+    if (!worker.joinable())
+      return;
+    if (infinite)
+      halt();
+    else
+      worker.join();
+  }
+
+  void position(istringstream &args) {
+    string word;
+    if (!(args >> word) || word != "startpos") {
+      say("info string expected: position startpos [moves ...]");
+      return;
+    }
+    vector<pair<int, int>> line;
+    State st;
+    if (args >> word) {
+      if (word != "moves") {
+        say("info string expected 'moves', got '" + word + "'");
+        return;
+      }
+      while (args >> word) {
+        pair<int, int> mv;
+        if (!parse_move(word, mv) || !is_legal_move(st, mv)) {
+          say("info string illegal move " + word);
+          return;
+        }
+        st.apply_move(mv);
+        line.push_back(mv);
+      }
+    }
+    halt();
+    bool extends = line.size() >= moves.size() &&
+                   equal(moves.begin(), moves.end(), line.begin());
+    if (!extends) {
+      searcher.set_position(State());
+      moves.clear();
+    }
+    for (size_t i = moves.size(); i < line.size(); ++i)
+      searcher.advance(line[i]);
+    moves = line;
+    searcher.tidy(); // nothing is on the clock between requests
+  }
+
+  void go(istringstream &args) {
+    if (running) {
+      say("info string already searching");
+      return;
+    }
+    if (worker.joinable())
+      worker.join(); // finished on its own
+    SearchLimits limits;
+    string word;
+    while (args >> word) {
+      if (word == "movetime") {
+        double ms = 0;
+        args >> ms;
+        limits.deadline =
+            chrono::steady_clock::now() +
+            chrono::duration_cast<chrono::steady_clock::duration>(
+                chrono::duration<double, milli>(ms));
+      } else if (word == "iterations") {
+        args >> limits.iterations;
+      } else if (word != "infinite") {
+        say("info string unknown go option " + word);
+        return;
+      }
+    }
+    if (searcher.root.is_terminal()) {
+      say("bestmove none");
+      return;
+    }
+    auto start = chrono::steady_clock::now();
+    auto next_info = start;
+    limits.publish = [this, start, next_info](pair<int, int> mv) mutable {
+      auto now = chrono::steady_clock::now();
+      if (now < next_info)
+        return;
+      next_info = now + chrono::duration_cast<chrono::steady_clock::duration>(
+                            chrono::duration<double, milli>(info_ms));
+      say(info_line(chrono::duration<double>(now - start).count(), mv));
+    };
+    infinite = limits.iterations == 0 &&
+               limits.deadline == chrono::steady_clock::time_point::max();
+    limits.abort = &abort;
+    abort = false;
+    running = true;
+    worker = thread([this, limits, start] {
+      searcher.search(limits);
+      double seconds =
+          chrono::duration<double>(chrono::steady_clock::now() - start)
+              .count();
+      pair<int, int> best = searcher.best_move();
+      if (best.first < 0) { // stopped before the first iteration
+        State::MoveList legal;
+        searcher.root.get_valid_moves(legal);
+        best = legal[0];
+      }
+      say(info_line(seconds, best));
+      say("bestmove " + format_move(best));
+      running = false;
+    });
+  }
+
+  string info_line(double seconds, const pair<int, int> &best) const {
+    const SearchStats &st = searcher.stats();
+    ostringstream line;
+    line << "info time " << static_cast<long>(seconds * 1000)
+         << " iterations " << st.iterations << " nodes " << st.nodes;
+    if (st.depth)
+      line << " depth " << st.depth;
+    if (st.value >= 0)
+      line << " value " << st.value;
+    line << " nps "
+         << (seconds > 0 ? static_cast<long>(st.iterations / seconds) : 0)
+         << " bestmove " << format_move(best);
+    return line.str();
+  }
+};
+
+inline int run_analysis(Searcher &searcher, double info_ms) {
+  AnalysisSession session(searcher, info_ms);
+  string text;
+  while (getline(cin, text)) {
+    istringstream args(text);
+    string command;
+    if (!(args >> command))
+      continue;
+    if (command == "uci") {
+      session.say(string("id name mcts-v2 ") + searcher.name());
+      session.say("uciok");
+    } else if (command == "isready") {
+      session.say("readyok");
+    } else if (command == "newgame") {
+      session.halt();
+      searcher.set_position(State());
+      session.moves.clear();
+    } else if (command == "position") {
+      session.position(args);
+    } else if (command == "go") {
+      session.go(args);
+    } else if (command == "stop") {
+      session.halt();
+    } else if (command == "quit") {
+      return 0; // the session stops any search on its way out
+    } else {
+      session.say("info string unknown command " + command);
+    }
+  }
+  session.finish();
+  return 0;
+}
@@ -0,0 +1,204 @@
+#pragma once
+// Search benchmarks: fixed positions (bench) and board geometries (geometry).
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <vector>
+
+#include "alloc.h"
+#include "engines.h"
+#include "evalcache.h"
+#include "flags.h"
+#include "mcts.h"
+#include "policy.h"
+#include "searcher.h"
+
+// ----------------------------------------------------------------------
+// Benchmark: fixed positions, fixed time per position
+// ----------------------------------------------------------------------
+// Move sequences leading to the benchmark positions
+inline vector<vector<pair<int, int>>> bench_lines() {
+  vector<vector<pair<int, int>>> lines;
+  mt19937 rng(560);
+  for (int plies : {0, 8, 16, 24}) {
+    State st;
+    vector<pair<int, int>> line;
+    for (int i = 0; i < plies && !st.is_terminal(); ++i) {
+      auto moves = st.get_valid_moves();
+      line.push_back(moves[rng() % moves.size()]);
+      st.apply_move(line.back());
+    }
+    lines.push_back(line);
+  }
+  return lines;
+}
+
+inline vector<State> bench_positions() {
+  vector<State> positions;
+  for (const auto &line : bench_lines()) {
+    State st;
+    for (const auto &mv : line)
+      st.apply_move(mv);
+    positions.push_back(st);
+  }
+  return positions;
+}
+
+// bench [seconds] [--engine NAME] [--iterations N] [--eval-cache-mb MB]
+// and the engine options of make_searcher. The seed defaults to 1 so runs
+// are repeatable.
+inline int run_bench(const Flags &flags) {
+  double seconds =
+      flags.positional.empty() ? 1.0 : atof(flags.positional[0].c_str());
+  Flags options = flags;
+  if (!options.has("seed"))
+    options.values["seed"] = "1";
+  unique_ptr<Searcher> searcher = make_searcher(options);
+  if (!searcher) {
+    cerr << "unknown engine " << flags.get("engine", "") << endl;
+    return 1;
+  }
+  long iterations = flags.get("iterations", 0);
+  EvalCache &cache = eval_cache();
+  cache.resize(flags.get("eval-cache-mb", DEFAULT_EVAL_CACHE_MB));
+  int index = 0;
+  for (const State &pos : bench_positions()) {
+    searcher->set_position(pos);
+    cache.clear_stats();
+    SearchLimits limits;
+    limits.iterations = iterations;
+    if (iterations == 0)
+      limits.deadline = chrono::steady_clock::now() +
+                        chrono::duration_cast<chrono::steady_clock::duration>(
+                            chrono::duration<double>(seconds));
+    AllocCounts before = alloc_counts();
+    searcher->search(limits);
+    AllocCounts allocs = alloc_counts() - before;
+    cout << "position " << index++ << ": ";
+    print_stats(cout, searcher->stats());
+    print_allocs(cout, allocs);
+    cout << endl;
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------
+// Tree reuse: one self-play game through MctsSearcher
+// ----------------------------------------------------------------------
+// reuse [seconds] [--iterations N] [--compact 0|1] [--seed N] [--prior N]
+// Every move is searched, played and passed to advance() and tidy(), so
+// each turn starts from the previous turn's subtree. With a fixed number of
+// iterations per move the game does not depend on the machine, and runs
+// with and without --compact play the same moves, so their search times
+// compare the arena layouts directly.
+inline int run_reuse_bench(const Flags &flags) {
+  double seconds =
+      flags.positional.empty() ? 0.1 : atof(flags.positional[0].c_str());
+  long iterations = flags.get("iterations", 0);
+  MctsSearcher searcher(static_cast<unsigned>(flags.get("seed", 1)),
+                        flags.get("prior", 0), true);
+  searcher.compact = flags.get("compact", 1) != 0;
+  searcher.set_position(State());
+  double search_s = 0, tidy_ms = 0;
+  long total = 0, reused = 0;
+  int ply = 0;
+  for (; !searcher.root.is_terminal(); ++ply) {
+    SearchLimits limits;
+    limits.iterations = iterations;
+    if (iterations == 0)
+      limits.deadline = chrono::steady_clock::now() +
+                        chrono::duration_cast<chrono::steady_clock::duration>(
+                            chrono::duration<double>(seconds));
+    searcher.search(limits);
+    const SearchStats &st = searcher.stats();
+    cout << "ply " << ply << ": ";
+    print_stats(cout, st);
+    cout << endl;
+    search_s += st.seconds;
+    tidy_ms += st.tidy_ms;
+    total += st.iterations;
+    reused += st.reused;
+    pair<int, int> mv = searcher.best_move();
+    if (mv.first < 0) { // nothing searched, e.g. --iterations 0
+      cout << "no move found, stopping" << endl;
+      break;
+    }
+    searcher.advance(mv);
+    searcher.tidy();
+  }
+  cout << "game: plies " << ply << ", iterations " << total
+       << ", iterations/sec " << static_cast<long>(total / search_s)
+       << ", reused visits " << reused << ", tidy " << tidy_ms << " ms"
+       << endl;
+  return 0;
+}
+
+// alloc-check [iterations] [--prior N] [--playout uniform|policy]: MCTS on
+// every bench position; fails unless selection, simulation and
+// backpropagation stayed off the heap. Needs a build with -DUTTT_COUNT_ALLOCS.
+inline int run_alloc_check(const Flags &flags) {
+  if (!COUNTING_ALLOCS) {
+    cerr << "alloc-check needs a build with -DUTTT_COUNT_ALLOCS" << endl;
+    return 2;
+  }
+  long iterations =
+      flags.positional.empty() ? 20000 : atol(flags.positional[0].c_str());
+  mt19937 rng(1);
+  Tree tree;
+  tree.prior_visits = flags.get("prior", 0);
+  if (flags.get("playout", "policy") == "policy")
+    tree.policy = playout_policy();
+  bool ok = true;
+  int index = 0;
+  for (const State &pos : bench_positions()) {
+    tree.reset(pos);
+    AllocCounts before = alloc_counts();
+    for (long i = 0; i < iterations; ++i)
+      tree.mcts_iteration(rng);
+    AllocCounts d = alloc_counts() - before;
+    bool clean = d.count[ALLOC_SELECT] == 0 && d.count[ALLOC_SIMULATE] == 0 &&
+                 d.count[ALLOC_BACKPROP] == 0;
+    ok = ok && clean;
+    cout << "position " << index++ << ": iterations " << iterations;
+    print_allocs(cout, d);
+    cout << (clean ? "" : "  FAIL") << endl;
+  }
+  cout << (ok ? "ok" : "allocations in the playout loop") << endl;
+  return ok ? 0 : 1;
+}
+
+// ----------------------------------------------------------------------
+// Geometry scaling: the same search on 1-, 2- and 3-level boards
+// ----------------------------------------------------------------------
+template <class S> void bench_geometry(const char *name, double seconds) {
+  mt19937 rng(1);
+  BasicTree<S> tree;
+  tree.reset(S());
+  auto start = chrono::steady_clock::now();
+  int iterations = 0;
+  chrono::duration<double> elapsed{};
+  while (elapsed.count() < seconds) {
+    tree.mcts_iteration(rng);
+    ++iterations;
+    elapsed = chrono::steady_clock::now() - start;
+  }
+  long per_sec = static_cast<long>(iterations / elapsed.count());
+  cout << name << ": cells " << S::SIDE * S::SIDE << ", sizeof(state) "
+       << sizeof(S) << ", iterations/sec " << per_sec << ", nodes "
+       << tree.num_nodes() << ", bytes/node " << tree.bytes_per_node()
+       << endl;
+}
+
+// geometry [seconds]
+inline int run_geometry_bench(const Flags &flags) {
+  double seconds =
+      flags.positional.empty() ? 1.0 : atof(flags.positional[0].c_str());
+  bench_geometry<BasicState<1>>("classic (1 level)", seconds);
+  bench_geometry<State>("ultimate, State", seconds);
+  bench_geometry<BasicState<2>>("ultimate (2 levels)", seconds);
+  bench_geometry<BasicState<3>>("ultimate-ultimate (3 levels)", seconds);
+  return 0;
+}
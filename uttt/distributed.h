@@ -0,0 +1,233 @@
+#pragma once
+// Distributed root-parallel MCTS.
+//
+// Every worker process grows its own tree for the same position. A
+// coordinator splits the search into sync rounds; after each round the
+// workers report their root-child statistics, the coordinator sums them
+// and sends the totals back, and each worker folds the other workers'
+// share into its own root children before the next round. The final move
+// is the root child with the most visits summed over all workers.
+//
+// Protocol, one text line per message:
+//   coordinator -> worker  search SEED SYNC_MS ROUNDS N r c ... (N moves)
+//   worker -> coordinator  stats ITERATIONS cell visits wins ...
+//   coordinator -> worker  merge cell visits wins ...  (not after the last)
+//   coordinator -> worker  quit
+
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mcts.h"
+#include "moves.h"
+#include "net.h"
+
+struct RootStats {
+  array<double, 81> visits{}, wins{};
+  long iterations = 0;
+
+  string encode(const string &tag, bool with_iterations) const {
+    ostringstream out;
+    out.precision(15);
+    out << tag;
+    if (with_iterations)
+      out << " " << iterations;
+    for (int cell = 0; cell < 81; ++cell)
+      if (visits[cell] > 0)
+        out << " " << cell << " " << visits[cell] << " " << wins[cell];
+    return out.str();
+  }
+
+  bool decode(const string &line, const string &tag, bool with_iterations) {
+    istringstream in(line);
+    string word;
+    if (!(in >> word) || word != tag)
+      return false;
+    if (with_iterations && !(in >> iterations))
+      return false;
+    int cell;
+    double v, w;
+    while (in >> cell >> v >> w) {
+      if (cell < 0 || cell >= 81)
+        return false;
+      visits[cell] = v;
+      wins[cell] = w;
+    }
+    return true;
+  }
+};
+
+// ----------------------------------------------------------------------
+// Worker
+// ----------------------------------------------------------------------
+struct DistributedWorker {
+  Tree tree;
+  mt19937 rng;
+  RootStats external; // other workers' share already folded into the tree
+
+  // Root-child statistics produced by this worker alone
+  RootStats local_stats(long iterations) const {
+    RootStats st;
+    st.iterations = iterations;
+    const Node &root = tree.nodes[tree.root];
+    uint32_t end = root.first_child + root.num_children;
+    for (uint32_t c = root.first_child; c < end; ++c) {
+      const Node &ch = tree.nodes[c];
+      st.visits[ch.cell] = ch.visits - external.visits[ch.cell];
+      st.wins[ch.cell] = ch.wins - external.wins[ch.cell];
+    }
+    return st;
+  }
+
+  // Make the root children carry the merged totals
+  void fold(const RootStats &total, const RootStats &own) {
+    Node &root = tree.nodes[tree.root];
+    uint32_t end = root.first_child + root.num_children;
+    for (uint32_t c = root.first_child; c < end; ++c) {
+      Node &ch = tree.nodes[c];
+      double ext_v = total.visits[ch.cell] - own.visits[ch.cell];
+      double ext_w = total.wins[ch.cell] - own.wins[ch.cell];
+      int dv = static_cast<int>(lround(ext_v - external.visits[ch.cell]));
+      ch.visits += dv;
+      ch.wins += ext_w - external.wins[ch.cell];
+      root.visits += dv;
+      external.visits[ch.cell] = ext_v;
+      external.wins[ch.cell] = ext_w;
+    }
+  }
+
+  bool search(LineSocket &conn, istringstream &cmd) {
+    unsigned seed;
+    int sync_ms, rounds, n;
+    cmd >> seed >> sync_ms >> rounds >> n;
+    State st;
+    for (int i = 0; i < n; ++i) {
+      pair<int, int> mv;
+      if (!(cmd >> mv.first >> mv.second) || !is_legal_move(st, mv))
+        return conn.write_line("error bad position");
+      st.apply_move(mv);
+    }
+    if (!cmd || st.is_terminal() || sync_ms <= 0)
+      return conn.write_line("error bad position");
+
+    rng.seed(seed);
+    tree.reset(st);
+    external = RootStats();
+    long iterations = 0;
+    for (int round = 0; round < rounds; ++round) {
+      auto end = chrono::steady_clock::now() + chrono::milliseconds(sync_ms);
+      while (chrono::steady_clock::now() < end) {
+        tree.mcts_iteration(rng);
+        ++iterations;
+      }
+      RootStats own = local_stats(iterations);
+      if (!conn.write_line(own.encode("stats", true)))
+        return false;
+      if (round + 1 == rounds)
+        break;
+      string line;
+      RootStats total;
+      if (!conn.read_line(line) || !total.decode(line, "merge", false))
+        return false;
+      fold(total, own);
+    }
+    return true;
+  }
+
+  // Serve one coordinator connection until it quits or disconnects
+  void serve(LineSocket &conn) {
+    string line;
+    while (conn.read_line(line)) {
+      istringstream cmd(line);
+      string word;
+      cmd >> word;
+      if (word == "quit")
+        break;
+      if (word != "search" || !search(conn, cmd))
+        break;
+    }
+    conn.close_fd();
+  }
+};
+
+// ----------------------------------------------------------------------
+// Coordinator
+// ----------------------------------------------------------------------
+struct DistributedResult {
+  pair<int, int> best_move{-1, -1};
+  RootStats total;
+  double seconds = 0;
+};
+
+struct Coordinator {
+  vector<LineSocket> workers;
+
+  bool search(const vector<pair<int, int>> &moves, double seconds,
+              int sync_ms, unsigned seed, DistributedResult &result) {
+    if (sync_ms <= 0) {
+      cerr << "sync interval must be positive" << endl;
+      return false;
+    }
+    int rounds = max(1, static_cast<int>(lround(seconds * 1000 / sync_ms)));
+    ostringstream tail;
+    tail << " " << sync_ms << " " << rounds << " " << moves.size();
+    for (const auto &mv : moves)
+      tail << " " << mv.first << " " << mv.second;
+
+    // Each worker gets its own seed so the trees diverge
+    auto start = chrono::steady_clock::now();
+    for (size_t w = 0; w < workers.size(); ++w) {
+      string cmd = "search " + to_string(seed + 7919 * w) + tail.str();
+      if (!workers[w].write_line(cmd))
+        return false;
+    }
+
+    RootStats total;
+    for (int round = 0; round < rounds; ++round) {
+      total = RootStats();
+      for (LineSocket &w : workers) {
+        string line;
+        RootStats st;
+        if (!w.read_line(line) || !st.decode(line, "stats", true)) {
+          cerr << "worker failed: " << line << endl;
+          return false;
+        }
+        total.iterations += st.iterations;
+        for (int cell = 0; cell < 81; ++cell) {
+          total.visits[cell] += st.visits[cell];
+          total.wins[cell] += st.wins[cell];
+        }
+      }
+      if (round + 1 < rounds) {
+        string merged = total.encode("merge", false);
+        for (LineSocket &w : workers)
+          if (!w.write_line(merged))
+            return false;
+      }
+    }
+
+    result.total = total;
+    result.seconds =
+        chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    double best = -1;
+    for (int cell = 0; cell < 81; ++cell)
+      if (total.visits[cell] > best) {
+        best = total.visits[cell];
+        result.best_move = {cell / 9, cell % 9};
+      }
+    return true;
+  }
+
+  void quit() {
+    for (LineSocket &w : workers) {
+      w.write_line("quit");
+      w.close_fd();
+    }
+    workers.clear();
+  }
+};
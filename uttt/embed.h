@@ -0,0 +1,87 @@
+#pragma once
+// Binary data embedded in the submission source.
+//
+// CodinGame only accepts one source file, so precomputed tables (opening
+// books, weights, solved positions) travel inside it as base-85 string
+// literals. tools/amalgamate.py emits one literal per --embed argument and
+// defines UTTT_EMBEDDED_BLOBS to list them before this header is inlined.
+// Development builds have no embedded blobs and read data/<name> instead.
+
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct EmbeddedBlob {
+  const char *name;
+  size_t size;      // decoded size in bytes
+  const char *data; // base-85 text (RFC 1924 alphabet)
+};
+
+#ifndef UTTT_EMBEDDED_BLOBS
+#define UTTT_EMBEDDED_BLOBS
+#endif
+static const EmbeddedBlob EMBEDDED_BLOBS[] = {
+    UTTT_EMBEDDED_BLOBS{nullptr, 0, nullptr}};
+
+// Decode RFC 1924 base-85 text as written by Python's base64.b85encode:
+// 5 characters per 4 bytes, big-endian, with a short final group.
+inline vector<uint8_t> decode_base85(const char *text, size_t size) {
+  static const char ALPHABET[] = "0123456789"
+                                 "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+                                 "abcdefghijklmnopqrstuvwxyz"
+                                 "!#$%&()*+-;<=>?@^_`{|}~";
+  uint8_t value[256];
+  memset(value, 0, sizeof(value));
+  for (int i = 0; i < 85; ++i)
+    value[static_cast<uint8_t>(ALPHABET[i])] = static_cast<uint8_t>(i);
+
+  vector<uint8_t> out(size);
+  size_t len = strlen(text), o = 0;
+  for (size_t i = 0; i < len && o < size; i += 5) {
+    uint32_t acc = 0;
+    for (size_t k = 0; k < 5; ++k) {
+      uint8_t d = i + k < len ? value[static_cast<uint8_t>(text[i + k])] : 84;
+      acc = acc * 85 + d;
+    }
+    for (int k = 3; k >= 0 && o < size; --k)
+      out[o++] = static_cast<uint8_t>(acc >> (8 * k));
+  }
+  return out;
+}
+
+// Look up a blob by name: embedded copy first, then data/<name> on disk.
+// Decoded blobs are cached, so repeated lookups are free.
+inline const vector<uint8_t> *find_blob(const string &name) {
+  static map<string, vector<uint8_t>> cache;
+  auto it = cache.find(name);
+  if (it != cache.end())
+    return &it->second;
+  for (const EmbeddedBlob *b = EMBEDDED_BLOBS; b->name; ++b)
+    if (name == b->name)
+      return &(cache[name] = decode_base85(b->data, b->size));
+  ifstream in("data/" + name, ios::binary);
+  if (!in)
+    return nullptr;
+  return &(cache[name] = vector<uint8_t>(istreambuf_iterator<char>(in), {}));
+}
+
+// Decode every embedded blob up front so the cost lands in the 1 s first turn
+inline void decode_embedded_blobs() {
+  auto start = chrono::steady_clock::now();
+  size_t bytes = 0, count = 0;
+  for (const EmbeddedBlob *b = EMBEDDED_BLOBS; b->name; ++b, ++count)
+    bytes += find_blob(b->name)->size();
+  if (!count)
+    return;
+  chrono::duration<double, milli> ms = chrono::steady_clock::now() - start;
+  cerr << "Decoded " << count << " embedded blobs (" << bytes << " bytes) in "
+       << ms.count() << " ms" << endl;
+}
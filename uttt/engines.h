@@ -0,0 +1,278 @@
+#pragma once
+// The search engines behind the Searcher interface, their telemetry and the
+// --engine factory shared by the bot, the benchmarks and the tools.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "alphabeta.h"
+#include "evalcache.h"
+#include "flags.h"
+#include "mcts.h"
+#include "policy.h"
+#include "searcher.h"
+#include "state.h"
+
+// ----------------------------------------------------------------------
+// MCTS
+// ----------------------------------------------------------------------
+// Keeps the subtree of the move actually played between searches unless
+// reuse is off, and compacts it in tidy() unless compaction is off.
+struct MctsSearcher : Searcher {
+  Tree tree;
+  mt19937 rng;
+  bool reuse;
+  bool compact = true;
+  double tidy_ms = 0; // reported with the next search
+
+  MctsSearcher(unsigned seed, int prior_visits, bool reuse_tree)
+      : rng(seed), reuse(reuse_tree) {
+    tree.prior_visits = prior_visits;
+    tree.reset(root);
+  }
+
+  const char *name() const override { return "mcts"; }
+
+  void set_position(const State &st) override {
+    root = st;
+    tree.reset(st);
+  }
+
+  void advance(const pair<int, int> &mv) override {
+    root.apply_move(mv);
+    if (!reuse || !tree.reroot(mv))
+      tree.reset(root);
+  }
+
+  void tidy() override {
+    if (!compact || tree.root == 0)
+      return;
+    auto start = chrono::steady_clock::now();
+    tree.compact();
+    chrono::duration<double, milli> t = chrono::steady_clock::now() - start;
+    tidy_ms += t.count();
+  }
+
+  void search(const SearchLimits &limits) override {
+    stopping.store(false, memory_order_relaxed);
+    SearchBudget budget(limits, stopping);
+    last = SearchStats();
+    last.reused = tree.nodes[tree.root].visits;
+    last.tidy_ms = tidy_ms;
+    tidy_ms = 0;
+    while (!budget.exhausted()) {
+      tree.mcts_iteration(rng);
+      if ((++budget.used & 63) == 0) {
+        progress(budget);
+        budget.publish(best_move());
+      }
+    }
+    progress(budget);
+    last.seconds = budget.elapsed();
+    last.bytes_per_node = tree.bytes_per_node();
+  }
+
+  void progress(const SearchBudget &budget) {
+    last.iterations = budget.used;
+    last.nodes = tree.num_nodes();
+    uint32_t best = tree.best_child();
+    last.value = best != NO_NODE
+                     ? tree.nodes[best].wins / tree.nodes[best].visits
+                     : -1.0;
+  }
+
+  pair<int, int> best_move() const override {
+    uint32_t best = tree.best_child();
+    return best != NO_NODE ? tree.move(best) : make_pair(-1, -1);
+  }
+};
+
+// ----------------------------------------------------------------------
+// Hybrid: alpha-beta tactics, then MCTS
+// ----------------------------------------------------------------------
+// A shallow alpha-beta pass takes a share of the budget first. A forced
+// win it finds is played outright; otherwise MCTS decides, skipping root
+// moves the tactical pass proved lost.
+struct HybridSearcher : Searcher {
+  AlphaBetaSearcher tactics;
+  MctsSearcher mcts;
+  double tactics_share; // fraction of the time budget for alpha-beta
+
+  HybridSearcher(unsigned seed, int prior_visits, bool reuse_tree,
+                 int tactics_depth, double share)
+      : mcts(seed, prior_visits, reuse_tree), tactics_share(share) {
+    tactics.max_depth = tactics_depth;
+  }
+
+  const char *name() const override { return "hybrid"; }
+
+  void set_position(const State &st) override {
+    root = st;
+    tactics.set_position(st);
+    mcts.set_position(st);
+  }
+
+  void advance(const pair<int, int> &mv) override {
+    root.apply_move(mv);
+    tactics.advance(mv);
+    mcts.advance(mv);
+  }
+
+  void tidy() override { mcts.tidy(); }
+
+  void stop() override {
+    Searcher::stop();
+    tactics.stop();
+    mcts.stop();
+  }
+
+  void search(const SearchLimits &limits) override {
+    stopping.store(false, memory_order_relaxed);
+    SearchBudget budget(limits, stopping);
+    SearchLimits first = limits;
+    first.iterations = 0; // alpha-beta is bounded by its depth instead
+    if (limits.deadline != chrono::steady_clock::time_point::max())
+      first.deadline =
+          budget.start +
+          chrono::duration_cast<chrono::steady_clock::duration>(
+              (limits.deadline - budget.start) * tactics_share);
+    last = SearchStats();
+    if (limits.publish)
+      first.publish = [&](pair<int, int> mv) {
+        tactics_stats();
+        limits.publish(mv);
+      };
+    tactics.search(first);
+    if (!proven_win() && !budget.exhausted()) {
+      SearchLimits second = limits;
+      if (limits.publish)
+        second.publish = [&](pair<int, int> mv) {
+          last = mcts.last;
+          last.depth = tactics.last.depth;
+          limits.publish(mv);
+        };
+      mcts.search(second);
+      last = mcts.last;
+      last.depth = tactics.last.depth;
+    } else {
+      tactics_stats(); // MCTS did not run this turn
+    }
+    last.seconds = budget.elapsed();
+  }
+
+  // Telemetry of the alpha-beta pass alone
+  void tactics_stats() {
+    last = SearchStats();
+    last.iterations = tactics.last.iterations;
+    last.nodes = static_cast<size_t>(tactics.last.iterations);
+    last.depth = tactics.last.depth;
+    last.value = tactics.last.value;
+  }
+
+  bool proven_win() const {
+    return tactics.last.depth > 0 &&
+           tactics.root_moves[0].second > PROVEN_SCORE;
+  }
+
+  pair<int, int> best_move() const override {
+    if (proven_win())
+      return tactics.best_move();
+    // Root children by visits, first one not proved lost
+    const Tree &t = mcts.tree;
+    const Node &r = t.nodes[t.root];
+    vector<uint32_t> order;
+    for (uint32_t c = r.first_child; c < r.first_child + r.num_children; ++c)
+      order.push_back(c);
+    sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+      return t.nodes[a].visits > t.nodes[b].visits;
+    });
+    for (uint32_t c : order)
+      if (tactics.last.depth == 0 ||
+          tactics.score_of(t.move(c)) > -PROVEN_SCORE)
+        return t.move(c);
+    return order.empty() ? tactics.best_move() : t.move(order[0]);
+  }
+};
+
+// ----------------------------------------------------------------------
+// Telemetry and factory
+// ----------------------------------------------------------------------
+// One line of search statistics, shared by the bot's stderr and bench
+inline void print_stats(ostream &out, const SearchStats &st) {
+  long per_sec = st.seconds > 0 ? static_cast<long>(st.iterations / st.seconds)
+                                : 0;
+  out << "iterations " << st.iterations << ", iterations/sec " << per_sec;
+  if (st.nodes)
+    out << ", nodes " << st.nodes;
+  if (st.depth)
+    out << ", depth " << st.depth;
+  if (st.reused)
+    out << ", reused " << st.reused;
+  if (st.tidy_ms > 0)
+    out << ", tidy " << st.tidy_ms << " ms";
+  if (st.bytes_per_node > 0)
+    out << ", bytes/node " << st.bytes_per_node;
+  const EvalCache &cache = eval_cache();
+  if (cache.probes.load())
+    out << ", eval cache hits " << 100 * cache.hit_rate() << "%";
+}
+
+// --engine mcts|alphabeta|hybrid, plus the engine options:
+//   --seed N, --prior N, --reuse 0|1, --compact 0|1, --depth N,
+//   --tactics-share F, --playout uniform|policy, --policy-file PATH,
+//   --reward win|graded, --margin-weight F, --length-weight F
+// Returns nullptr for an unknown engine.
+inline unique_ptr<Searcher> make_searcher(const Flags &flags) {
+  string engine = flags.get("engine", "mcts");
+  unsigned seed = flags.has("seed")
+                      ? static_cast<unsigned>(flags.get("seed", 0))
+                      : static_cast<unsigned>(chrono::system_clock::now()
+                                                  .time_since_epoch()
+                                                  .count());
+  int prior = flags.get("prior", 0);
+  bool reuse = flags.get("reuse", 1) != 0;
+  bool compact = flags.get("compact", 1) != 0;
+  // The trained policy when it ships, or --policy-file; uniform playouts
+  // otherwise
+  const PlayoutPolicy *policy = nullptr;
+  if (flags.get("playout", "policy") == "policy") {
+    policy = flags.has("policy-file")
+                 ? load_playout_policy(flags.get("policy-file", ""))
+                 : playout_policy();
+    if (!policy && (flags.has("playout") || flags.has("policy-file")))
+      cerr << "no playout policy, using uniform playouts" << endl;
+  }
+  auto configure = [&](MctsSearcher &m) {
+    m.compact = compact;
+    m.tree.policy = policy;
+    if (flags.get("reward", "win") == "graded") {
+      m.tree.margin_weight = flags.get("margin-weight", 0.05);
+      m.tree.length_weight = flags.get("length-weight", 0.05);
+    }
+  };
+  if (engine == "mcts") {
+    auto s = make_unique<MctsSearcher>(seed, prior, reuse);
+    configure(*s);
+    return s;
+  }
+  if (engine == "alphabeta") {
+    auto s = make_unique<AlphaBetaSearcher>();
+    s->max_depth = flags.get("depth", 81);
+    return s;
+  }
+  if (engine == "hybrid") {
+    auto s = make_unique<HybridSearcher>(seed, prior, reuse,
+                                         flags.get("depth", 4),
+                                         flags.get("tactics-share", 0.2));
+    configure(s->mcts);
+    return s;
+  }
+  return nullptr;
+}
@@ -0,0 +1,109 @@
+#pragma once
+// Lock-free evaluation cache keyed by Zobrist hash.
+//
+// A fixed-size, direct-mapped table of 64-bit words. Low key bits pick the
+// slot; the word keeps the upper 48 key bits as a check and the score,
+// quantised to int16 over [-1, 1], in its lower 16 bits. Each word is read
+// and written with one relaxed atomic access, so racing threads can
+// overwrite each other's entries but never see a torn one; a stale or
+// replaced entry only costs a re-evaluation. A word of 0 marks an empty
+// slot. The table outlives the search tree, so positions evaluated on one
+// turn are still cached on the next. It comes from calloc, so the OS hands
+// out zero pages as they are first touched instead of the process clearing
+// the whole table at startup, inside the first turn's time.
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+#include "local.h"
+#include "state.h"
+
+static const int DEFAULT_EVAL_CACHE_MB = 16;
+
+struct EvalCache {
+  static constexpr uint64_t CHECK_MASK = ~uint64_t(0xFFFF);
+
+  struct Free {
+    void operator()(atomic<uint64_t> *p) const { free(p); }
+  };
+  unique_ptr<atomic<uint64_t>[], Free> table;
+  size_t slots = 0;
+  uint64_t mask = 0;
+  atomic<uint64_t> probes{0}, hits{0};
+
+  explicit EvalCache(int mb = DEFAULT_EVAL_CACHE_MB) { resize(mb); }
+
+  // Largest power-of-two slot count that fits in mb megabytes; 0 disables.
+  // Not safe while other threads probe the cache.
+  void resize(int mb) {
+    static_assert(sizeof(atomic<uint64_t>) == sizeof(uint64_t) &&
+                      atomic<uint64_t>::is_always_lock_free,
+                  "cache words must be plain lock-free 64-bit words");
+    table.reset();
+    slots = 0;
+    if (mb > 0) {
+      slots = 1;
+      while (slots * 2 * sizeof(uint64_t) <= size_t(mb) << 20)
+        slots *= 2;
+      table.reset(static_cast<atomic<uint64_t> *>(
+          calloc(slots, sizeof(atomic<uint64_t>))));
+      if (!table)
+        slots = 0;
+    }
+    mask = slots ? slots - 1 : 0;
+    clear_stats();
+  }
+
+  size_t bytes() const { return slots * sizeof(uint64_t); }
+
+  bool probe(uint64_t key, double &score) {
+    if (!slots)
+      return false;
+    probes.fetch_add(1, memory_order_relaxed);
+    uint64_t word = table[key & mask].load(memory_order_relaxed);
+    if (word == 0 || (word & CHECK_MASK) != (key & CHECK_MASK))
+      return false;
+    hits.fetch_add(1, memory_order_relaxed);
+    score = static_cast<int16_t>(word & 0xFFFF) / 32767.0;
+    return true;
+  }
+
+  void store(uint64_t key, double score) {
+    if (!slots)
+      return;
+    auto q = static_cast<int16_t>(lround(score * 32767));
+    uint64_t word = (key & CHECK_MASK) | static_cast<uint16_t>(q);
+    table[key & mask].store(word, memory_order_relaxed);
+  }
+
+  void clear_stats() {
+    probes.store(0, memory_order_relaxed);
+    hits.store(0, memory_order_relaxed);
+  }
+
+  double hit_rate() const {
+    uint64_t p = probes.load(memory_order_relaxed);
+    return p ? double(hits.load(memory_order_relaxed)) / p : 0.0;
+  }
+};
+
+// The process-wide cache used by every search mode and thread. Size it with
+// eval_cache().resize() before searching.
+inline EvalCache &eval_cache() {
+  static EvalCache cache;
+  return cache;
+}
+
+// local_eval through the shared cache
+inline double cached_local_eval(const State &st) {
+  EvalCache &cache = eval_cache();
+  double v;
+  if (cache.probe(st.hash, v))
+    return v;
+  v = local_eval(st);
+  cache.store(st.hash, v);
+  return v;
+}
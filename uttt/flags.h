@@ -0,0 +1,58 @@
+#pragma once
+// Command-line flags of the form --name value, plus positional arguments.
+
+#include <algorithm>
+#include <cstdlib>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct Flags {
+  map<string, string> values;
+  vector<string> positional;
+
+  Flags(int argc, char **argv, int first = 1)
+      : Flags(vector<string>(argv + min(first, argc), argv + argc)) {}
+
+  // Whitespace-separated words, e.g. one player's options in arena mode
+  explicit Flags(const string &words) : Flags(split(words)) {}
+
+  explicit Flags(const vector<string> &args) {
+    for (size_t i = 0; i < args.size(); ++i) {
+      if (args[i].rfind("--", 0) == 0 && i + 1 < args.size()) {
+        values[args[i].substr(2)] = args[i + 1];
+        ++i;
+      } else {
+        positional.push_back(args[i]);
+      }
+    }
+  }
+
+  static vector<string> split(const string &words) {
+    istringstream in(words);
+    vector<string> out;
+    for (string w; in >> w;)
+      out.push_back(w);
+    return out;
+  }
+
+  bool has(const string &name) const { return values.count(name) > 0; }
+
+  string get(const string &name, const string &def) const {
+    auto it = values.find(name);
+    return it == values.end() ? def : it->second;
+  }
+
+  double get(const string &name, double def) const {
+    auto it = values.find(name);
+    return it == values.end() ? def : atof(it->second.c_str());
+  }
+
+  int get(const string &name, int def) const {
+    auto it = values.find(name);
+    return it == values.end() ? def : atoi(it->second.c_str());
+  }
+};
@@ -0,0 +1,282 @@
+#pragma once
+// Recursive tic-tac-toe geometry as a compile-time parameter.
+//
+// A board of Levels levels is a 3x3 grid of boards of Levels - 1 levels,
+// down to 3x3 grids of cells: Levels = 1 is classic tic-tac-toe, 2 is
+// Ultimate Tic-Tac-Toe (81 cells, same rules as State) and 3 is
+// "ultimate-ultimate" (729 cells). All index tables are built by constexpr
+// code, so each instantiation pays nothing at startup.
+//
+// A cell is addressed by its digit path d0 d1 ... d(L-1), one base-9 digit
+// per level from the top. The sending rule generalises the 2-level one: a
+// move at d0 d1 ... d(L-1) sends the opponent to the smallest board d1 ...
+// d(L-1). If that board is closed or full, the target widens to its parent
+// board, and so on up to the whole board. Closed boards take no moves. At
+// the top level a full board with no line goes to the side that won more
+// boards, as in the CodinGame rules.
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+// The eight lines of a 3x3 grid as 9-bit masks (bit = row * 3 + col)
+constexpr array<int, 8> make_win_lines() {
+  array<int, 8> lines{};
+  for (int i = 0; i < 3; ++i) {
+    lines[i] = 0x7 << (3 * i); // rows
+    lines[3 + i] = 0x49 << i;  // columns
+  }
+  for (int i = 0; i < 3; ++i) { // diagonals
+    lines[6] |= 1 << (4 * i);
+    lines[7] |= 1 << (2 * i + 2);
+  }
+  return lines;
+}
+
+// The cells of each line of make_win_lines(), in increasing order
+constexpr array<array<int, 3>, 8> make_line_cells() {
+  array<array<int, 3>, 8> cells{};
+  constexpr array<int, 8> lines = make_win_lines();
+  for (int k = 0; k < 8; ++k)
+    for (int i = 0, n = 0; i < 9; ++i)
+      if ((lines[k] >> i) & 1)
+        cells[k][n++] = i;
+  return cells;
+}
+
+constexpr int ipow(int base, int exp) {
+  return exp == 0 ? 1 : base * ipow(base, exp - 1);
+}
+
+// The eight symmetries of a 3x3 grid as cell permutations: cell i goes to
+// [g][i] after mirroring the columns if g & 4, then rotating a quarter turn
+// g & 3 times
+constexpr array<array<int, 9>, 8> make_square_symmetries() {
+  array<array<int, 9>, 8> sym{};
+  for (int g = 0; g < 8; ++g)
+    for (int i = 0; i < 9; ++i) {
+      int r = i / 3, c = i % 3;
+      if (g & 4)
+        c = 2 - c;
+      for (int k = 0; k < (g & 3); ++k) {
+        int t = r;
+        r = c;
+        c = 2 - t;
+      }
+      sym[g][i] = r * 3 + c;
+    }
+  return sym;
+}
+
+// Base-3 value of a 9-bit mask read as digits 0 and 1
+constexpr array<uint16_t, 512> make_ternary() {
+  array<uint16_t, 512> table{};
+  for (int m = 0; m < 512; ++m)
+    for (int i = 0, p = 1; i < 9; ++i, p *= 3)
+      if ((m >> i) & 1)
+        table[m] = static_cast<uint16_t>(table[m] + p);
+  return table;
+}
+
+// 512-entry table: does a 9-bit mask contain a line?
+constexpr array<bool, 512> make_win_table() {
+  array<bool, 512> table{};
+  constexpr array<int, 8> lines = make_win_lines();
+  for (int m = 0; m < 512; ++m)
+    for (int w : lines)
+      if ((m & w) == w)
+        table[m] = true;
+  return table;
+}
+
+// Move list with room for every cell, kept on the stack so that playouts
+// and searches can generate moves without touching the heap
+template <int N> struct FixedMoves {
+  array<pair<int, int>, N> items;
+  int count = 0;
+
+  void push(int r, int c) { items[count++] = {r, c}; }
+  int size() const { return count; }
+  bool empty() const { return count == 0; }
+  const pair<int, int> &operator[](int i) const { return items[i]; }
+  const pair<int, int> *begin() const { return items.data(); }
+  const pair<int, int> *end() const { return items.data() + count; }
+};
+
+template <int Levels> struct Geometry {
+  static_assert(Levels >= 1 && Levels <= 3, "1 to 3 levels supported");
+
+  static constexpr int SIDE = ipow(3, Levels);       // cells per row
+  static constexpr int CELLS = ipow(9, Levels);      // cells in total
+  static constexpr int LEAVES = ipow(9, Levels - 1); // 3x3 grids of cells
+  static constexpr int COMPOSITE = (LEAVES - 1) / 8; // 3x3 grids of boards
+
+  // First composite board of each level in the flat status arrays
+  static constexpr array<int, Levels> make_offsets() {
+    array<int, Levels> off{};
+    for (int k = 1; k < Levels; ++k)
+      off[k] = off[k - 1] + ipow(9, k - 1);
+    return off;
+  }
+
+  // Row-major cell -> (leaf board, position in leaf)
+  static constexpr array<uint16_t, CELLS> make_leaf_of() {
+    array<uint16_t, CELLS> leaf{};
+    for (int r = 0; r < SIDE; ++r)
+      for (int c = 0; c < SIDE; ++c) {
+        int b = 0;
+        for (int k = 0; k < Levels - 1; ++k) {
+          int scale = ipow(3, Levels - 1 - k);
+          b = b * 9 + ((r / scale) % 3) * 3 + (c / scale) % 3;
+        }
+        leaf[r * SIDE + c] = static_cast<uint16_t>(b);
+      }
+    return leaf;
+  }
+
+  static constexpr array<uint8_t, CELLS> make_pos_of() {
+    array<uint8_t, CELLS> pos{};
+    for (int r = 0; r < SIDE; ++r)
+      for (int c = 0; c < SIDE; ++c)
+        pos[r * SIDE + c] = static_cast<uint8_t>((r % 3) * 3 + c % 3);
+    return pos;
+  }
+
+  // (leaf board * 9 + position) -> row-major cell
+  static constexpr array<uint16_t, CELLS> make_cell_at() {
+    array<uint16_t, CELLS> cell{};
+    constexpr array<uint16_t, CELLS> leaf = make_leaf_of();
+    constexpr array<uint8_t, CELLS> pos = make_pos_of();
+    for (int i = 0; i < CELLS; ++i)
+      cell[leaf[i] * 9 + pos[i]] = static_cast<uint16_t>(i);
+    return cell;
+  }
+
+  static constexpr array<int, Levels> OFFSET = make_offsets();
+  static constexpr array<uint16_t, CELLS> LEAF_OF = make_leaf_of();
+  static constexpr array<uint8_t, CELLS> POS_OF = make_pos_of();
+  static constexpr array<uint16_t, CELLS> CELL_AT = make_cell_at();
+};
+
+template <int Levels> struct BasicState {
+  using G = Geometry<Levels>;
+  static constexpr int SIDE = G::SIDE;
+  static constexpr int FILLED = 0x1FF;
+  static constexpr array<bool, 512> WIN = make_win_table();
+
+  // Leaf boards: lower 9 bits for X, next 9 bits for O
+  array<uint32_t, G::LEAVES> leaf;
+  // Composite boards: which of their 9 children are won by X, O or drawn
+  array<uint16_t, G::COMPOSITE> childX, childO, childD;
+  int target_level, target_board; // region the next move must be played in
+  bool turnX;
+  int winner; // 0 = ongoing, 1 = X wins, -1 = O wins, 2 = draw
+
+  BasicState()
+      : leaf{}, childX{}, childO{}, childD{}, target_level(0),
+        target_board(0), turnX(true), winner(0) {}
+  BasicState copy() const { return *this; }
+
+  // Closed: won or drawn according to its parent (the top: game over)
+  bool closed(int level, int board) const {
+    if (level == 0)
+      return winner != 0;
+    int slot = G::OFFSET[level - 1] + board / 9;
+    return ((childX[slot] | childO[slot] | childD[slot]) >> (board % 9)) & 1;
+  }
+
+  bool playable(int level, int board) const {
+    if (level == Levels - 1 &&
+        ((leaf[board] | leaf[board] >> 9) & FILLED) == FILLED)
+      return false;
+    for (; level > 0; --level, board /= 9)
+      if (closed(level, board))
+        return false;
+    return true;
+  }
+
+  using MoveList = FixedMoves<G::CELLS>;
+
+  vector<pair<int, int>> get_valid_moves() const {
+    MoveList moves;
+    get_valid_moves(moves);
+    return {moves.begin(), moves.end()};
+  }
+
+  void get_valid_moves(MoveList &moves) const {
+    moves.count = 0;
+    int level = target_level, board = target_board;
+    while (level > 0 && !playable(level, board)) {
+      --level;
+      board /= 9;
+    }
+    int span = ipow(9, Levels - 1 - level);
+    for (int b = board * span; b < (board + 1) * span; ++b) {
+      if (!playable(Levels - 1, b))
+        continue;
+      int filled = (leaf[b] | leaf[b] >> 9) & FILLED;
+      for (int i = 0; i < 9; ++i)
+        if (!((filled >> i) & 1)) {
+          int cell = G::CELL_AT[b * 9 + i];
+          moves.push(cell / SIDE, cell % SIDE);
+        }
+    }
+  }
+
+  // 0 open, 1 X, -1 O, 2 draw for a grid given its X/O/drawn masks
+  static int grid_status(int x, int o, int d, bool top) {
+    if (WIN[x])
+      return 1;
+    if (WIN[o])
+      return -1;
+    if ((x | o | d) != FILLED)
+      return 0;
+    if (!top)
+      return 2;
+    int xc = __builtin_popcount(x), oc = __builtin_popcount(o);
+    return xc > oc ? 1 : (oc > xc ? -1 : 2);
+  }
+
+  void apply_move(const pair<int, int> &mv) {
+    int cell = mv.first * SIDE + mv.second;
+    int b = G::LEAF_OF[cell], pos = G::POS_OF[cell];
+    leaf[b] |= 1u << (turnX ? pos : pos + 9);
+
+    // Propagate a closed board upwards until a board stays open
+    int status = grid_status(leaf[b] & FILLED, leaf[b] >> 9, 0, false);
+    int level = Levels - 1, board = b;
+    while (status != 0 && level > 0) {
+      int slot = G::OFFSET[level - 1] + board / 9;
+      int bit = 1 << (board % 9);
+      if (status == 1)
+        childX[slot] |= bit;
+      else if (status == -1)
+        childO[slot] |= bit;
+      else
+        childD[slot] |= bit;
+      status = grid_status(childX[slot], childO[slot], childD[slot],
+                           level == 1);
+      --level;
+      board /= 9;
+    }
+    if (level == 0 && status != 0)
+      winner = status;
+
+    // Send the opponent to the board addressed by the lower digits
+    target_level = Levels - 1;
+    target_board = (b * 9 + pos) % G::LEAVES;
+    turnX = !turnX;
+  }
+
+  bool is_terminal() const { return winner != 0; }
+
+  int get_winner() const {
+    if (winner == 2)
+      return 0;
+    return winner ? winner : numeric_limits<int>::min();
+  }
+};
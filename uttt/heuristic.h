@@ -0,0 +1,55 @@
+#pragma once
+// Cheap one-ply move choice, used when no search result is available.
+
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "state.h"
+
+// ----------------------------------------------------------------------
+// Heuristic Move (bitboard evaluator)
+// ----------------------------------------------------------------------
+// One-ply move scoring used when the search has produced nothing: take or
+// block sub-boards, prefer centre and corners, and avoid handing the
+// opponent a free choice or an immediate sub-board win.
+inline int heuristic_score(const State &st, const pair<int, int> &mv) {
+  int s = (mv.first / 3) * 3 + (mv.second / 3);
+  int pos = (mv.first % 3) * 3 + (mv.second % 3);
+  int own = st.turnX ? st.sub[s] & FILLED_MASK : (st.sub[s] >> 9) & FILLED_MASK;
+  int opp = st.turnX ? (st.sub[s] >> 9) & FILLED_MASK : st.sub[s] & FILLED_MASK;
+  int score = pos == 4 ? 3 : (pos % 2 == 0 ? 2 : 1);
+  if (State::isWin(own | (1 << pos)))
+    score += 100;
+  else if (State::isWin(opp | (1 << pos)))
+    score += 50;
+
+  State next = st.copy();
+  next.apply_move(mv);
+  if (next.is_terminal())
+    return next.get_winner() == (st.turnX ? 1 : -1) ? 10000 : score;
+  if (next.sub_idx == 9)
+    return score - 30;
+  int t = next.sub_idx;
+  int next_own = next.turnX ? next.sub[t] & FILLED_MASK
+                            : (next.sub[t] >> 9) & FILLED_MASK;
+  int free_cells = ~(next.sub[t] | (next.sub[t] >> 9)) & FILLED_MASK;
+  for (int i = 0; i < 9; ++i)
+    if (((free_cells >> i) & 1) && State::isWin(next_own | (1 << i)))
+      return score - 20;
+  return score;
+}
+
+inline pair<int, int> heuristic_move(const State &st,
+                                     const vector<pair<int, int>> &moves) {
+  pair<int, int> best = moves[0];
+  int best_score = numeric_limits<int>::min();
+  for (const auto &mv : moves) {
+    int score = heuristic_score(st, mv);
+    if (score > best_score) {
+      best_score = score;
+      best = mv;
+    }
+  }
+  return best;
+}
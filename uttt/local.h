@@ -0,0 +1,128 @@
+#pragma once
+// Local-game decomposition of the sub-boards.
+//
+// Each sub-board is solved as an isolated 3x3 game for both sides to move,
+// together with the number of uninterrupted moves each side still needs
+// for a line (its tempo count). Results are tabulated once, keyed by the
+// 18-bit sub-board mask used in State::sub, and combined into a meta-board
+// assessment with nine lookups. The assessment serves as an MCTS prior and
+// as a static evaluation for alpha-beta leaves.
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "state.h"
+
+static constexpr array<array<int, 3>, 8> LINE_CELLS = make_line_cells();
+
+struct LocalEntry {
+  int8_t value_x;  // outcome of the isolated game with X to move: 1, 0, -1
+  int8_t value_o;  // same with O to move
+  uint8_t tempo_x; // X moves needed for a line if O never answers, 9 = never
+  uint8_t tempo_o;
+  uint8_t share_x; // rough chance X ends up owning the sub-board, 0-255
+  uint8_t share_o;
+};
+
+struct LocalTable {
+  vector<LocalEntry> entries; // indexed by x | o << 9
+  vector<int8_t> memo;        // solver scratch: value + 2, 0 = unknown
+
+  LocalTable() : entries(1 << 18), memo(2 << 18, 0) {
+    for (int key = 0; key < (1 << 18); ++key) {
+      int x = key & FILLED_MASK, o = key >> 9;
+      if (x & o)
+        continue;
+      LocalEntry &e = entries[key];
+      e.value_x = solve(x, o, true);
+      e.value_o = solve(x, o, false);
+      e.tempo_x = tempo(x, o);
+      e.tempo_o = tempo(o, x);
+      e.share_x = share(e.value_x, e.value_o, e.tempo_x);
+      e.share_o = share(-e.value_o, -e.value_x, e.tempo_o);
+    }
+    memo.clear();
+    memo.shrink_to_fit();
+  }
+
+  // Plain minimax over the isolated sub-board, from X's point of view
+  int solve(int x, int o, bool x_to_move) {
+    if (State::isWin(x))
+      return 1;
+    if (State::isWin(o))
+      return -1;
+    int filled = x | o;
+    if (filled == FILLED_MASK)
+      return 0;
+    int8_t &m = memo[(x | o << 9) * 2 + x_to_move];
+    if (m)
+      return m - 2;
+    int best = x_to_move ? -1 : 1;
+    for (int i = 0; i < 9; ++i) {
+      if ((filled >> i) & 1)
+        continue;
+      int v = x_to_move ? solve(x | 1 << i, o, false)
+                        : solve(x, o | 1 << i, true);
+      best = x_to_move ? max(best, v) : min(best, v);
+    }
+    m = static_cast<int8_t>(best + 2);
+    return best;
+  }
+
+  static uint8_t tempo(int own, int opp) {
+    int best = 9;
+    for (int w : WIN_LINES)
+      if (!(w & opp))
+        best = min(best, __builtin_popcount(w & ~own));
+    return static_cast<uint8_t>(best);
+  }
+
+  // own_first: local outcome for this side when it moves first,
+  // own_second: when the opponent moves first
+  static uint8_t share(int own_first, int own_second, int tempo) {
+    static const double TEMPO_SHARE[4] = {1.0, 0.35, 0.22, 0.12};
+    double p = tempo > 3 ? 0.0 : TEMPO_SHARE[tempo];
+    if (own_second == 1)
+      p = 0.8;
+    else if (own_first == 1)
+      p = 0.5;
+    return static_cast<uint8_t>(p * 255 + 0.5);
+  }
+
+  const LocalEntry &operator[](int key) const { return entries[key]; }
+};
+
+inline const LocalTable &local_table() {
+  static const LocalTable table;
+  return table;
+}
+
+// Meta-board assessment from X's point of view, in [-1, 1]: the chance X
+// completes some meta line minus the chance O does, treating sub-boards as
+// independent.
+inline double local_eval(const State &st) {
+  if (st.is_terminal())
+    return st.get_winner();
+  const LocalTable &table = local_table();
+  double px[9], po[9];
+  for (int s = 0; s < 9; ++s) {
+    if ((st.metaX >> s) & 1) {
+      px[s] = 1, po[s] = 0;
+    } else if ((st.metaO >> s) & 1) {
+      px[s] = 0, po[s] = 1;
+    } else if ((st.metaD >> s) & 1) {
+      px[s] = 0, po[s] = 0;
+    } else {
+      const LocalEntry &e = table[st.sub[s]];
+      px[s] = e.share_x / 255.0;
+      po[s] = e.share_o / 255.0;
+    }
+  }
+  double none_x = 1, none_o = 1;
+  for (const auto &line : LINE_CELLS) {
+    none_x *= 1 - px[line[0]] * px[line[1]] * px[line[2]];
+    none_o *= 1 - po[line[0]] * po[line[1]] * po[line[2]];
+  }
+  return (1 - none_x) - (1 - none_o);
+}
@@ -0,0 +1,321 @@
+#pragma once
+// Monte Carlo tree search over an index-linked node arena.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "alloc.h"
+#include "evalcache.h"
+#include "policy.h"
+#include "state.h"
+
+// ----------------------------------------------------------------------
+// MCTS Node Arena
+// ----------------------------------------------------------------------
+// Nodes live in one vector and link to each other by 32-bit index instead of
+// pointer. The children of a node occupy one contiguous block of slots that
+// is reserved on its first expansion (one slot per legal move), so a node
+// only needs the index of its first child plus a count. The state and move
+// list of a node sit in a second arena that only grows for constructed
+// nodes. Indices stay valid when the arenas grow, which also makes the tree
+// relocatable as a whole.
+static const uint32_t NO_NODE = numeric_limits<uint32_t>::max();
+
+// Link and statistics record. Reserved child slots only cost this much.
+struct Node {
+  double wins;
+  int visits;
+  uint32_t parent;      // NO_NODE for the root
+  uint32_t first_child; // start of the child block, NO_NODE if unexpanded
+  uint32_t data;        // index into Tree::data, NO_NODE for a reserved slot
+  uint16_t num_children; // expanded children in the block
+  uint16_t cell;         // move that led here, as r * SIDE + c
+  bool moves_ready;      // untried_moves has been generated
+
+  Node()
+      : wins(0), visits(0), parent(NO_NODE), first_child(NO_NODE),
+        data(NO_NODE), num_children(0), cell(0xFFFF), moves_ready(false) {}
+};
+
+// Value of a finished playout for each side, in [0, 1]
+struct Reward {
+  double x, o;
+};
+
+// Payload of a constructed node. Most leaves are visited once, by the
+// playout launched from them, so the move list is only generated when the
+// node is selected again for expansion (see BasicTree::untried).
+template <class S> struct BasicNodeData {
+  S state;
+  vector<pair<int, int>> untried_moves;
+
+  BasicNodeData() = default;
+  explicit BasicNodeData(const S &st) : state(st) {}
+};
+
+// Search tree over any state type with the State interface (S::SIDE,
+// get_valid_moves, apply_move, turnX, is_terminal, get_winner)
+template <class S> struct BasicTree {
+  using NodeData = BasicNodeData<S>;
+
+  vector<Node> nodes;    // the arena; reset() puts the root at nodes[0]
+  vector<NodeData> data; // one entry per constructed node
+  uint32_t root = 0;     // moves forward when the tree is reused
+  vector<Node> spare_nodes;    // compaction target, swapped with the arenas
+  vector<NodeData> spare_data;
+  vector<uint32_t> spare_from; // compaction scratch: old index per new slot
+  int prior_visits = 0;  // virtual visits seeded from local_eval, 0 = off
+  const PlayoutPolicy *policy = nullptr; // State only; nullptr = uniform
+  // Graded rewards (State only): shares of the sub-board margin and of the
+  // game-length term in the playout value. Both 0 = plain wins.
+  double margin_weight = 0, length_weight = 0;
+
+  size_t num_nodes() const { return data.size(); }
+  const S &state(uint32_t n) const { return data[nodes[n].data].state; }
+  pair<int, int> move(uint32_t n) const {
+    return {nodes[n].cell / S::SIDE, nodes[n].cell % S::SIDE};
+  }
+  // Legal moves not expanded yet, generated on first use. Terminal nodes
+  // have none. A node with children has its list already.
+  vector<pair<int, int>> &untried(uint32_t n) {
+    NodeData &d = data[nodes[n].data];
+    if (!nodes[n].moves_ready) {
+      if (!d.state.is_terminal())
+        d.untried_moves = d.state.get_valid_moves();
+      nodes[n].moves_ready = true;
+    }
+    return d.untried_moves;
+  }
+
+  // Drop the previous tree but keep the arena capacity for the next turn
+  void reset(const S &st) {
+    nodes.clear();
+    data.clear();
+    root = 0;
+    nodes.emplace_back();
+    nodes[0].data = 0;
+    data.emplace_back(st);
+  }
+
+  // Keep the subtree below the root child reached by mv as the new tree.
+  // Nodes outside it stay in the arena until the next reset. Returns false
+  // if that child was never constructed.
+  bool reroot(const pair<int, int> &mv) {
+    uint16_t cell = static_cast<uint16_t>(mv.first * S::SIDE + mv.second);
+    const Node &r = nodes[root];
+    if (r.first_child == NO_NODE)
+      return false;
+    for (uint32_t c = r.first_child; c < r.first_child + r.num_children; ++c)
+      if (nodes[c].cell == cell) {
+        nodes[c].parent = NO_NODE;
+        root = c;
+        return true;
+      }
+    return false;
+  }
+
+  // Copy the subtree under root breadth-first into the spare arenas, so the
+  // nodes that survived a reroot() sit together again and the dead ones are
+  // dropped. Child blocks keep their reserved slots. The spare arenas keep
+  // their capacity from turn to turn, so this does not allocate once warm.
+  // Returns the number of nodes kept.
+  size_t compact() {
+    spare_nodes.clear();
+    spare_data.clear();
+    spare_from.clear();
+    spare_nodes.push_back(nodes[root]);
+    spare_nodes[0].parent = NO_NODE;
+    spare_from.push_back(root);
+    for (size_t i = 0; i < spare_nodes.size(); ++i) {
+      uint32_t old = spare_from[i];
+      if (old == NO_NODE)
+        continue; // reserved slot, never constructed
+      const Node &src = nodes[old];
+      spare_nodes[i].data = static_cast<uint32_t>(spare_data.size());
+      spare_data.push_back(std::move(data[src.data]));
+      if (src.first_child == NO_NODE)
+        continue;
+      spare_nodes[i].first_child = static_cast<uint32_t>(spare_nodes.size());
+      size_t block = src.num_children + spare_data.back().untried_moves.size();
+      for (size_t k = 0; k < block; ++k) {
+        bool built = k < src.num_children;
+        spare_nodes.push_back(built ? nodes[src.first_child + k] : Node());
+        spare_nodes.back().parent = static_cast<uint32_t>(i);
+        spare_from.push_back(built ? src.first_child + k : NO_NODE);
+      }
+    }
+    nodes.swap(spare_nodes);
+    data.swap(spare_data);
+    spare_nodes.clear(); // frees the dead nodes' move lists now, keeps
+    spare_data.clear();  // the capacity for next time
+    root = 0;
+    return data.size();
+  }
+
+  uint32_t uct_select(uint32_t n) const {
+    const Node &node = nodes[n];
+    double log_parent = log(node.visits);
+    uint32_t best = node.first_child;
+    uint32_t end = node.first_child + node.num_children;
+    double best_u = -numeric_limits<double>::infinity();
+    for (uint32_t c = node.first_child; c < end; ++c) {
+      const Node &ch = nodes[c];
+      double u = ch.wins / ch.visits + sqrt(2 * log_parent / ch.visits);
+      if (u > best_u) {
+        best_u = u;
+        best = c;
+      }
+    }
+    return best;
+  }
+
+  uint32_t expand(uint32_t n, mt19937 &rng) {
+    if (nodes[n].first_child == NO_NODE) {
+      size_t block = untried(n).size();
+      if (nodes.size() + block >= NO_NODE)
+        return n; // arena exhausted, simulate from here instead
+      nodes[n].first_child = static_cast<uint32_t>(nodes.size());
+      nodes.resize(nodes.size() + block); // may reallocate: no refs held
+    }
+    auto &moves = untried(n);
+    uniform_int_distribution<size_t> dist(0, moves.size() - 1);
+    size_t idx = dist(rng);
+    auto mv = moves[idx];
+    moves.erase(moves.begin() + idx);
+    S next_st = state(n).copy();
+    next_st.apply_move(mv);
+    uint32_t child = nodes[n].first_child + nodes[n].num_children++;
+    nodes[child].parent = n;
+    nodes[child].cell = static_cast<uint16_t>(mv.first * S::SIDE + mv.second);
+    nodes[child].data = static_cast<uint32_t>(data.size());
+    if constexpr (is_same<S, State>::value) {
+      if (prior_visits > 0) {
+        // Value of the child for the side that moved into it, in [0, 1]
+        double v = cached_local_eval(next_st) * (next_st.turnX ? -1 : 1);
+        nodes[child].visits = prior_visits;
+        nodes[child].wins = prior_visits * (v + 1) / 2;
+      }
+    }
+    data.emplace_back(next_st); // may reallocate: no refs held
+    return child;
+  }
+
+  // Random playout from node n; returns the final position
+  S simulate(uint32_t n, mt19937 &rng) const {
+    S st = state(n).copy();
+    if constexpr (is_same<S, State>::value) {
+      if (policy) {
+        while (!st.is_terminal())
+          st.apply_move(policy->sample(st, rng));
+        return st;
+      }
+    }
+    typename S::MoveList moves;
+    while (!st.is_terminal()) {
+      st.get_valid_moves(moves);
+      uniform_int_distribution<int> dist(0, moves.size() - 1);
+      st.apply_move(moves[dist(rng)]);
+    }
+    return st;
+  }
+
+  // A win is worth 1 and anything else 0, unless rewards are graded. Then
+  // X's value mixes the result (1, 0.5, 0) with the sub-board margin
+  // mapped from [-9, 9] to [0, 1] and a length term that moves a win
+  // towards 1 the fewer moves it took (and a loss towards 0.5 the longer
+  // it lasted). The weights are normalised, so the value stays in [0, 1];
+  // O gets 1 minus it.
+  Reward reward(const S &end) const {
+    int w = end.get_winner();
+    if constexpr (is_same<S, State>::value) {
+      if (margin_weight > 0 || length_weight > 0) {
+        double result_weight = max(0.0, 1 - margin_weight - length_weight);
+        int boards = __builtin_popcount(end.metaX) -
+                     __builtin_popcount(end.metaO);
+        int stones = 0;
+        for (int b : end.sub)
+          stones += __builtin_popcount(b);
+        double outcome = (w + 1) / 2.0;
+        double margin = (boards + 9) / 18.0;
+        double length = 0.5 + 0.5 * w * (1 - stones / 81.0);
+        double x = (result_weight * outcome + margin_weight * margin +
+                    length_weight * length) /
+                   (result_weight + margin_weight + length_weight);
+        return {x, 1 - x};
+      }
+    }
+    return {double(w == 1), double(w == -1)};
+  }
+
+  void backpropagate(uint32_t n, const Reward &r) {
+    while (n != NO_NODE) {
+      Node &node = nodes[n];
+      node.visits++;
+      if (node.parent != NO_NODE)
+        node.wins += state(node.parent).turnX ? r.x : r.o;
+      n = node.parent;
+    }
+  }
+
+  void mcts_iteration(mt19937 &rng) {
+    uint32_t n = root;
+    // selection; only nodes with children are asked for their untried
+    // moves, so no move list is generated here
+    {
+      AllocScope scope(ALLOC_SELECT);
+      while (nodes[n].num_children > 0 && untried(n).empty()) {
+        n = uct_select(n);
+      }
+    }
+    // expansion, including the leaf's move list on its second visit
+    {
+      AllocScope scope(ALLOC_EXPAND);
+      if (!untried(n).empty())
+        n = expand(n, rng);
+    }
+    // simulation
+    Reward result;
+    {
+      AllocScope scope(ALLOC_SIMULATE);
+      result = reward(simulate(n, rng));
+    }
+    // backpropagation
+    AllocScope scope(ALLOC_BACKPROP);
+    backpropagate(n, result);
+  }
+
+  // Most visited root child, NO_NODE if the root was never expanded
+  uint32_t best_child() const {
+    uint32_t best = NO_NODE;
+    int best_visits = -1;
+    const Node &r = nodes[root];
+    uint32_t end = r.first_child + r.num_children;
+    for (uint32_t c = r.first_child; c < end; ++c) {
+      if (nodes[c].visits > best_visits) {
+        best_visits = nodes[c].visits;
+        best = c;
+      }
+    }
+    return best;
+  }
+
+  // Arena footprint (link slots, payloads, move lists and the spare arenas)
+  // per live node
+  double bytes_per_node() const {
+    size_t bytes = (nodes.capacity() + spare_nodes.capacity()) * sizeof(Node);
+    bytes += (data.capacity() + spare_data.capacity()) * sizeof(NodeData);
+    bytes += spare_from.capacity() * sizeof(uint32_t);
+    for (const NodeData &d : data)
+      bytes += d.untried_moves.capacity() * sizeof(pair<int, int>);
+    return num_nodes() ? double(bytes) / num_nodes() : 0.0;
+  }
+};
+
+using NodeData = BasicNodeData<State>;
+using Tree = BasicTree<State>;
@@ -0,0 +1,35 @@
+#pragma once
+// Moves as text: two digits, row then column (0-8), e.g. "44" for the
+// centre, and the legality check for moves from outside the engine. Used
+// by the analysis protocol, the position tools and distributed search.
+
+#include <algorithm>
+#include <string>
+#include <utility>
+
+#include "state.h"
+
+inline string format_move(const pair<int, int> &mv) {
+  if (mv.first < 0)
+    return "none";
+  return string(1, char('0' + mv.first)) + char('0' + mv.second);
+}
+
+// false unless text is two digits 0-8
+inline bool parse_move(const string &text, pair<int, int> &mv) {
+  if (text.size() != 2 || text[0] < '0' || text[0] > '8' || text[1] < '0' ||
+      text[1] > '8')
+    return false;
+  mv = {text[0] - '0', text[1] - '0'};
+  return true;
+}
+
+// Whether mv may be played in st; anything read from a user or a peer must
+// pass this before State::apply_move, which trusts its input
+inline bool is_legal_move(const State &st, const pair<int, int> &mv) {
+  if (st.is_terminal())
+    return false;
+  State::MoveList legal;
+  st.get_valid_moves(legal);
+  return find(legal.begin(), legal.end(), mv) != legal.end();
+}
@@ -0,0 +1,147 @@
+#pragma once
+// Minimal line-oriented stream sockets (TCP or Unix domain, POSIX only).
+//
+// Addresses are written "unix:/path/to/socket" or "tcp:host:port". Errors
+// are reported on stderr and signalled by returning -1 or false.
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <string>
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+using namespace std;
+
+struct LineSocket {
+  int fd;
+  string buf;
+
+  explicit LineSocket(int f = -1) : fd(f) {}
+
+  bool read_line(string &line) {
+    while (true) {
+      size_t nl = buf.find('\n');
+      if (nl != string::npos) {
+        line = buf.substr(0, nl);
+        buf.erase(0, nl + 1);
+        return true;
+      }
+      char chunk[4096];
+      ssize_t got = recv(fd, chunk, sizeof(chunk), 0);
+      if (got < 0 && errno == EINTR)
+        continue;
+      if (got <= 0)
+        return false;
+      buf.append(chunk, got);
+    }
+  }
+
+  bool write_line(const string &line) {
+    string out = line + "\n";
+    size_t sent = 0;
+    while (sent < out.size()) {
+      ssize_t n = send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+      if (n < 0 && errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      sent += n;
+    }
+    return true;
+  }
+
+  void close_fd() {
+    if (fd >= 0)
+      ::close(fd);
+    fd = -1;
+  }
+};
+
+// Small messages go out immediately (no-op on Unix domain sockets)
+inline void set_nodelay(int fd) {
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+}
+
+// Resolve an address and either bind+listen or connect. Returns fd or -1.
+inline int open_socket(const string &addr, bool listening) {
+  int fd = -1;
+  if (addr.rfind("unix:", 0) == 0) {
+    sockaddr_un sa{};
+    sa.sun_family = AF_UNIX;
+    string path = addr.substr(5);
+    if (path.size() >= sizeof(sa.sun_path)) {
+      cerr << "socket path too long: " << path << endl;
+      return -1;
+    }
+    strcpy(sa.sun_path, path.c_str());
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listening)
+      unlink(sa.sun_path);
+    int rc = listening ? ::bind(fd, (sockaddr *)&sa, sizeof(sa))
+                       : connect(fd, (sockaddr *)&sa, sizeof(sa));
+    if (fd < 0 || rc < 0 || (listening && listen(fd, 8) < 0)) {
+      cerr << addr << ": " << strerror(errno) << endl;
+      if (fd >= 0)
+        ::close(fd);
+      return -1;
+    }
+    return fd;
+  }
+  if (addr.rfind("tcp:", 0) == 0) {
+    string rest = addr.substr(4);
+    size_t colon = rest.rfind(':');
+    if (colon == string::npos) {
+      cerr << "expected tcp:host:port, got " << addr << endl;
+      return -1;
+    }
+    string host = rest.substr(0, colon), port = rest.substr(colon + 1);
+    addrinfo hints{}, *res = nullptr;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = listening ? AI_PASSIVE : 0;
+    if (getaddrinfo(host.empty() ? nullptr : host.c_str(), port.c_str(),
+                    &hints, &res) != 0) {
+      cerr << "cannot resolve " << addr << endl;
+      return -1;
+    }
+    for (addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+      fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+      if (fd < 0)
+        continue;
+      int one = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+      bool ok = listening ? ::bind(fd, ai->ai_addr, ai->ai_addrlen) == 0 &&
+                                listen(fd, 8) == 0
+                          : connect(fd, ai->ai_addr, ai->ai_addrlen) == 0;
+      if (!ok) {
+        ::close(fd);
+        fd = -1;
+      }
+    }
+    freeaddrinfo(res);
+    if (fd < 0)
+      cerr << addr << ": " << strerror(errno) << endl;
+    else if (!listening)
+      set_nodelay(fd);
+    return fd;
+  }
+  cerr << "unknown address scheme: " << addr << endl;
+  return -1;
+}
+
+inline int accept_connection(int listen_fd) {
+  int fd;
+  do {
+    fd = accept(listen_fd, nullptr, nullptr);
+  } while (fd < 0 && errno == EINTR);
+  if (fd >= 0)
+    set_nodelay(fd);
+  return fd;
+}
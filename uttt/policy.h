@@ -0,0 +1,274 @@
+#pragma once
+// Pattern-based softmax playout policy.
+//
+// A playout move is scored by two weights. The pattern weight belongs to
+// the move's sub-board configuration (3^9, the mover's stones as digit 1
+// and the opponent's as 2) together with the target cell, with patterns
+// that differ by one of the eight symmetries of the 3x3 board sharing a
+// weight. The destination weight belongs to the status of the sub-board
+// the move sends the opponent to. A move is drawn with probability
+// proportional to exp(pattern + destination). exp(pattern) is tabulated for
+// every (configuration, cell) when the weights are loaded, so sampling
+// costs a lookup, a multiply and an add per legal move and a scan of the
+// running sums.
+//
+// The weights are trained offline from self-play records (train-policy,
+// see train.h) and shipped as the "playout_policy" blob, little-endian:
+//   "UPOL", uint32 version (1), uint32 class count, float32 scale,
+//   int8 weight per pattern class, int8 weight per DestStatus,
+// each weight being its int8 value times the scale.
+
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "embed.h"
+#include "state.h"
+
+// ----------------------------------------------------------------------
+// Patterns
+// ----------------------------------------------------------------------
+static const int NUM_CONFIGS = 19683;            // 3^9
+static const int NUM_PATTERNS = NUM_CONFIGS * 9; // configuration * 9 + cell
+
+// The destination sub-board after the move, from the opponent's side
+enum DestStatus {
+  DEST_OPEN = 0, // the opponent has to play there
+  DEST_FREE,     // closed: the opponent may play anywhere
+  DEST_THREAT,   // open, and the opponent can win it with one move
+  NUM_DEST
+};
+
+// Cells that would complete a line for a side holding mask m, occupied or
+// not
+constexpr array<uint16_t, 512> make_completions() {
+  array<uint16_t, 512> table{};
+  constexpr array<int, 8> lines = make_win_lines();
+  for (int m = 0; m < 512; ++m)
+    for (int w : lines)
+      if (__builtin_popcount(w & m) == 2)
+        table[m] = static_cast<uint16_t>(table[m] | (w & ~m));
+  return table;
+}
+
+static constexpr array<uint16_t, 512> COMPLETIONS = make_completions();
+
+// Calls fn(cell, pattern, dest) for every legal move of st, in the same
+// order as get_valid_moves: cell is r * 9 + c and pattern is configuration
+// * 9 + target cell from the mover's side
+template <class F> void for_each_pattern_move(const State &st, F fn) {
+  int me = st.turnX ? 0 : 9, them = 9 - me;
+  int closed = st.metaX | st.metaO | st.metaD;
+  // Destinations the move does not change itself
+  uint8_t dest[9];
+  for (int d = 0; d < 9; ++d) {
+    int opp = (st.sub[d] >> them) & FILLED_MASK;
+    int filled = (st.sub[d] | st.sub[d] >> 9) & FILLED_MASK;
+    dest[d] = ((closed >> d) & 1)               ? DEST_FREE
+              : (COMPLETIONS[opp] & ~filled) != 0 ? DEST_THREAT
+                                                  : DEST_OPEN;
+  }
+  auto board = [&](int s) {
+    int own = (st.sub[s] >> me) & FILLED_MASK;
+    int opp = (st.sub[s] >> them) & FILLED_MASK;
+    int filled = own | opp;
+    int config = TERNARY[own] + 2 * TERNARY[opp];
+    for (int empty = ~filled & FILLED_MASK; empty; empty &= empty - 1) {
+      int pos = __builtin_ctz(empty);
+      int d = dest[pos];
+      if (pos == s) { // the move sends the opponent back to this board
+        int now = filled | 1 << pos;
+        d = State::isWin(own | 1 << pos) || now == FILLED_MASK ? DEST_FREE
+            : (COMPLETIONS[opp] & ~now) != 0                   ? DEST_THREAT
+                                                               : DEST_OPEN;
+      }
+      int cell = ((s / 3) * 3 + pos / 3) * 9 + (s % 3) * 3 + pos % 3;
+      fn(cell, config * 9 + pos, d);
+    }
+  };
+  // A full sub-board is always closed (won or drawn)
+  if (st.sub_idx < 9 && !((closed >> st.sub_idx) & 1)) {
+    board(st.sub_idx);
+  } else {
+    for (int s = 0; s < 9; ++s)
+      if (!((closed >> s) & 1))
+        board(s);
+  }
+}
+
+// Classes of (configuration, empty target cell) under the symmetries of the
+// 3x3 board, numbered densely in order of first appearance
+struct PatternClasses {
+  static constexpr uint16_t NONE = 0xFFFF; // the target cell is occupied
+  vector<uint16_t> of;                     // class per pattern
+  int count = 0;
+
+  PatternClasses() : of(NUM_PATTERNS, NONE) {
+    constexpr array<array<int, 9>, 8> sym = make_square_symmetries();
+    int pow3[9];
+    for (int i = 0; i < 9; ++i)
+      pow3[i] = ipow(3, i);
+    vector<int> id(NUM_PATTERNS, -1);
+    for (int config = 0; config < NUM_CONFIGS; ++config) {
+      int image[8] = {}; // config under each symmetry
+      int filled = 0;
+      for (int i = 0, v = config; i < 9; ++i, v /= 3) {
+        filled |= (v % 3 != 0) << i;
+        for (int g = 0; g < 8; ++g)
+          image[g] += v % 3 * pow3[sym[g][i]];
+      }
+      for (int pos = 0; pos < 9; ++pos) {
+        if ((filled >> pos) & 1)
+          continue;
+        int canonical = NUM_PATTERNS;
+        for (int g = 0; g < 8; ++g)
+          canonical = min(canonical, image[g] * 9 + sym[g][pos]);
+        if (id[canonical] < 0)
+          id[canonical] = count++;
+        of[config * 9 + pos] = static_cast<uint16_t>(id[canonical]);
+      }
+    }
+  }
+};
+
+inline const PatternClasses &pattern_classes() {
+  static const PatternClasses classes;
+  return classes;
+}
+
+// ----------------------------------------------------------------------
+// Policy
+// ----------------------------------------------------------------------
+struct PlayoutPolicy {
+  vector<float> pattern_weight; // per pattern class
+  array<float, NUM_DEST> dest_weight{};
+  vector<float> pattern_exp; // exp(pattern weight) per pattern, 0 if illegal
+  array<float, NUM_DEST> dest_exp{};
+
+  PlayoutPolicy() : pattern_weight(pattern_classes().count, 0.0f) {
+    prepare();
+  }
+
+  // Rebuild the sampling tables after the weights changed
+  void prepare() {
+    const PatternClasses &classes = pattern_classes();
+    pattern_exp.assign(NUM_PATTERNS, 0.0f);
+    for (int p = 0; p < NUM_PATTERNS; ++p)
+      if (classes.of[p] != PatternClasses::NONE)
+        pattern_exp[p] = exp(pattern_weight[classes.of[p]]);
+    for (int d = 0; d < NUM_DEST; ++d)
+      dest_exp[d] = exp(dest_weight[d]);
+  }
+
+  // Quantised blob in the format described at the top of the file
+  vector<uint8_t> save() const {
+    float scale = 0;
+    for (float w : pattern_weight)
+      scale = max(scale, fabs(w) / 127);
+    for (float w : dest_weight)
+      scale = max(scale, fabs(w) / 127);
+    if (scale == 0)
+      scale = 1;
+    uint32_t version = 1, count = static_cast<uint32_t>(pattern_weight.size());
+    vector<uint8_t> blob(16);
+    memcpy(blob.data(), "UPOL", 4);
+    memcpy(blob.data() + 4, &version, 4);
+    memcpy(blob.data() + 8, &count, 4);
+    memcpy(blob.data() + 12, &scale, 4);
+    auto put = [&](float w) {
+      blob.push_back(static_cast<uint8_t>(static_cast<int8_t>(
+          lround(max(-127.0f, min(127.0f, w / scale))))));
+    };
+    for (float w : pattern_weight)
+      put(w);
+    for (float w : dest_weight)
+      put(w);
+    return blob;
+  }
+
+  // False if blob is not a policy for this pattern set
+  bool load(const vector<uint8_t> &blob) {
+    uint32_t version = 0, count = 0;
+    float scale = 0;
+    if (blob.size() < 16 || memcmp(blob.data(), "UPOL", 4) != 0)
+      return false;
+    memcpy(&version, blob.data() + 4, 4);
+    memcpy(&count, blob.data() + 8, 4);
+    memcpy(&scale, blob.data() + 12, 4);
+    if (version != 1 || count != pattern_weight.size() ||
+        blob.size() != 16 + count + NUM_DEST)
+      return false;
+    const int8_t *q = reinterpret_cast<const int8_t *>(blob.data() + 16);
+    for (uint32_t i = 0; i < count; ++i)
+      pattern_weight[i] = q[i] * scale;
+    for (int d = 0; d < NUM_DEST; ++d)
+      dest_weight[d] = q[count + d] * scale;
+    prepare();
+    return true;
+  }
+
+  // Draw a move of a non-terminal st
+  pair<int, int> sample(const State &st, mt19937 &rng) const {
+    float sum[81];
+    uint8_t cells[81];
+    int n = 0;
+    float total = 0;
+    for_each_pattern_move(st, [&](int cell, int pattern, int dest) {
+      total += pattern_exp[pattern] * dest_exp[dest];
+      sum[n] = total;
+      cells[n++] = static_cast<uint8_t>(cell);
+    });
+    float x = (rng() >> 8) * (total / 16777216.0f); // uniform in [0, total)
+    int i = 0;
+    while (i < n - 1 && sum[i] <= x)
+      ++i;
+    return {cells[i] / 9, cells[i] % 9};
+  }
+};
+
+// The shipped policy from the "playout_policy" blob, nullptr if there is
+// none or it does not match this build's pattern classes
+inline const PlayoutPolicy *playout_policy() {
+  static const unique_ptr<PlayoutPolicy> policy = [] {
+    const vector<uint8_t> *blob = find_blob("playout_policy");
+    if (!blob)
+      return unique_ptr<PlayoutPolicy>();
+    auto p = make_unique<PlayoutPolicy>();
+    if (!p->load(*blob)) {
+      cerr << "playout_policy blob does not match, ignoring it" << endl;
+      return unique_ptr<PlayoutPolicy>();
+    }
+    return p;
+  }();
+  return policy.get();
+}
+
+// A policy from a file written by train-policy, read once per path; nullptr
+// if the file cannot be read or does not match
+inline const PlayoutPolicy *load_playout_policy(const string &path) {
+  static map<string, unique_ptr<PlayoutPolicy>> loaded;
+  static mutex loaded_mutex;
+  lock_guard<mutex> lock(loaded_mutex);
+  auto it = loaded.find(path);
+  if (it != loaded.end())
+    return it->second.get();
+  ifstream in(path, ios::binary);
+  vector<uint8_t> blob{istreambuf_iterator<char>(in), {}};
+  auto p = make_unique<PlayoutPolicy>();
+  if (!in || !p->load(blob)) {
+    cerr << "cannot use " << path << " as a playout policy" << endl;
+    p.reset();
+  }
+  return (loaded[path] = move(p)).get();
+}
@@ -0,0 +1,542 @@
+#pragma once
+// External-memory aggregation of positions from game records (POSIX only).
+//
+// Every position before a move in the records is reduced to its canonical
+// key under the eight symmetries of the board and counted with the game's
+// result. Each worker thread collects keys up to its share of the memory
+// budget, sorts them and adds up duplicates in place, and writes a sorted
+// run when that no longer halves the buffer. The runs are then
+// memory-mapped and merged into one file of unique positions: the key space
+// is cut into one range per thread at sampled splitters, and the ranges are
+// merged in parallel and concatenated. Resident memory is the budget plus a
+// write buffer per thread; mapped runs are page cache, which the kernel
+// drops as needed.
+//
+// Output, little-endian: "UPOS", uint32 version (1), uint64 count, then
+// count PositionEntry records in key order, so a book or knowledge-store
+// builder can map the file and binary-search it (PositionTable).
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "records.h"
+#include "state.h"
+
+// ----------------------------------------------------------------------
+// Canonical keys
+// ----------------------------------------------------------------------
+// Sub-board configurations in base 3 (X = 1, O = 2) in board order, then
+// the target sub-board (9 = any). The side to move and the meta boards
+// follow from the stones.
+struct PositionKey {
+  array<uint16_t, 10> code;
+
+  bool operator<(const PositionKey &o) const { return code < o.code; }
+  bool operator==(const PositionKey &o) const { return code == o.code; }
+};
+
+struct PositionEntry {
+  PositionKey key;
+  uint32_t visits;  // occurrences in the records
+  uint32_t x_wins;  // of those, games X won
+  uint32_t o_wins;  // and games O won; the rest were drawn
+};
+static_assert(sizeof(PositionEntry) == 32, "runs are raw entry arrays");
+
+// Configuration code g * 3^9 + code -> code after square symmetry g
+inline const vector<uint16_t> &symmetric_codes() {
+  static const vector<uint16_t> table = [] {
+    constexpr array<array<int, 9>, 8> sym = make_square_symmetries();
+    const int configs = ipow(3, 9);
+    vector<uint16_t> t(8 * configs);
+    for (int code = 0; code < configs; ++code)
+      for (int g = 0; g < 8; ++g) {
+        int image = 0;
+        for (int i = 0, v = code; i < 9; ++i, v /= 3)
+          image += v % 3 * ipow(3, sym[g][i]);
+        t[g * configs + code] = static_cast<uint16_t>(image);
+      }
+    return t;
+  }();
+  return table;
+}
+
+// The least key among the eight images of st. The symmetries of the 9x9
+// board map sub-boards and the cells inside them by the same permutation,
+// and the sending rule commutes with it.
+inline PositionKey canonical_key(const State &st) {
+  constexpr array<array<int, 9>, 8> sym = make_square_symmetries();
+  const vector<uint16_t> &table = symmetric_codes();
+  const int configs = ipow(3, 9);
+  int code[9];
+  for (int s = 0; s < 9; ++s)
+    code[s] = TERNARY[st.sub[s] & FILLED_MASK] +
+              2 * TERNARY[(st.sub[s] >> 9) & FILLED_MASK];
+  PositionKey best;
+  for (int g = 0; g < 8; ++g) {
+    PositionKey k;
+    for (int s = 0; s < 9; ++s)
+      k.code[sym[g][s]] = table[g * configs + code[s]];
+    k.code[9] = static_cast<uint16_t>(st.sub_idx == 9 ? 9 : sym[g][st.sub_idx]);
+    if (g == 0 || k < best)
+      best = k;
+  }
+  return best;
+}
+
+// The position a key stands for, with meta boards, winner and hash filled
+// in
+inline State key_state(const PositionKey &k) {
+  State st;
+  int stones = 0;
+  for (int s = 0; s < 9; ++s) {
+    int x = 0, o = 0;
+    for (int i = 0, v = k.code[s]; i < 9; ++i, v /= 3) {
+      x |= (v % 3 == 1) << i;
+      o |= (v % 3 == 2) << i;
+    }
+    st.sub[s] = x | o << 9;
+    stones += __builtin_popcount(x | o);
+    if (State::isWin(x))
+      st.metaX |= 1 << s;
+    else if (State::isWin(o))
+      st.metaO |= 1 << s;
+    else if ((x | o) == FILLED_MASK)
+      st.metaD |= 1 << s;
+  }
+  st.sub_idx = k.code[9];
+  st.turnX = stones % 2 == 0;
+  int nx = __builtin_popcount(st.metaX), no = __builtin_popcount(st.metaO);
+  if (State::isWin(st.metaX))
+    st.winner = 1;
+  else if (State::isWin(st.metaO))
+    st.winner = -1;
+  else if ((st.metaX | st.metaO | st.metaD) == FILLED_MASK)
+    st.winner = nx > no ? 1 : no > nx ? -1 : 2;
+  st.hash = st.compute_hash();
+  return st;
+}
+
+// ----------------------------------------------------------------------
+// Files
+// ----------------------------------------------------------------------
+// Read-only mapping of a whole file
+struct MappedFile {
+  void *base = nullptr;
+  size_t bytes = 0;
+
+  MappedFile() = default;
+  MappedFile(const MappedFile &) = delete;
+  MappedFile &operator=(const MappedFile &) = delete;
+  ~MappedFile() { unmap(); }
+
+  bool map(const string &path) {
+    unmap();
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      perror(path.c_str());
+      return false;
+    }
+    struct stat info;
+    bool ok = fstat(fd, &info) == 0;
+    bytes = ok ? static_cast<size_t>(info.st_size) : 0;
+    if (ok && bytes > 0) {
+      base = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (base == MAP_FAILED) {
+        base = nullptr;
+        ok = false;
+      } else {
+        madvise(base, bytes, MADV_SEQUENTIAL);
+      }
+    }
+    if (!ok)
+      perror(path.c_str());
+    close(fd);
+    return ok;
+  }
+
+  void unmap() {
+    if (base)
+      munmap(base, bytes);
+    base = nullptr;
+    bytes = 0;
+  }
+
+  const uint8_t *data() const { return static_cast<const uint8_t *>(base); }
+};
+
+static const size_t POSITION_HEADER_BYTES = 16;
+
+inline void position_header(uint8_t *out, uint64_t count) {
+  uint32_t version = 1;
+  memcpy(out, "UPOS", 4);
+  memcpy(out + 4, &version, 4);
+  memcpy(out + 8, &count, 8);
+}
+
+// A merged position file, mapped for lookups
+struct PositionTable {
+  MappedFile file;
+  const PositionEntry *entries = nullptr;
+  size_t count = 0;
+
+  // False if path is not a position file
+  bool open(const string &path) {
+    if (!file.map(path))
+      return false;
+    uint32_t version = 0;
+    uint64_t n = 0;
+    if (file.bytes < POSITION_HEADER_BYTES ||
+        memcmp(file.data(), "UPOS", 4) != 0)
+      return false;
+    memcpy(&version, file.data() + 4, 4);
+    memcpy(&n, file.data() + 8, 8);
+    if (version != 1 ||
+        file.bytes != POSITION_HEADER_BYTES + n * sizeof(PositionEntry))
+      return false;
+    entries = reinterpret_cast<const PositionEntry *>(file.data() +
+                                                      POSITION_HEADER_BYTES);
+    count = n;
+    return true;
+  }
+
+  // The entry of st or any of its symmetric images, nullptr if absent
+  const PositionEntry *find(const State &st) const {
+    PositionKey key = canonical_key(st);
+    const PositionEntry *end = entries + count;
+    const PositionEntry *it = lower_bound(
+        entries, end, key,
+        [](const PositionEntry &e, const PositionKey &k) { return e.key < k; });
+    return it != end && it->key == key ? it : nullptr;
+  }
+};
+
+// ----------------------------------------------------------------------
+// External sort
+// ----------------------------------------------------------------------
+// Sorts v by key and adds up the counts of equal keys
+inline void combine_positions(vector<PositionEntry> &v) {
+  sort(v.begin(), v.end(), [](const PositionEntry &a, const PositionEntry &b) {
+    return a.key < b.key;
+  });
+  size_t out = 0;
+  for (const PositionEntry &e : v) {
+    if (out > 0 && v[out - 1].key == e.key) {
+      v[out - 1].visits += e.visits;
+      v[out - 1].x_wins += e.x_wins;
+      v[out - 1].o_wins += e.o_wins;
+    } else {
+      v[out++] = e;
+    }
+  }
+  v.resize(out);
+}
+
+struct PositionSorter {
+  size_t memory_bytes;
+  int threads;
+  string tmp_dir;
+  int skip_plies = 0;       // leading moves of every game left out
+  uint32_t min_visits = 1;  // rarer positions are dropped from the output
+
+  // Filled in as the phases run
+  uint64_t games = 0, bad_lines = 0, positions = 0, unique = 0;
+  vector<string> runs;
+  mutex runs_mutex;
+  bool failed = false;
+
+  PositionSorter(size_t memory, int thread_count, const string &dir)
+      : memory_bytes(memory), threads(max(1, thread_count)), tmp_dir(dir) {}
+
+  ~PositionSorter() {
+    for (const string &path : runs)
+      remove(path.c_str());
+  }
+
+  string temp_path(const string &kind, size_t n) const {
+    return tmp_dir + "/positions-" + kind + "-" + to_string(getpid()) + "-" +
+           to_string(n) + ".bin";
+  }
+
+  bool write_entries(FILE *f, const PositionEntry *e, size_t n) {
+    if (n > 0 && fwrite(e, sizeof(PositionEntry), n, f) != n) {
+      perror("write");
+      return false;
+    }
+    return true;
+  }
+
+  // Writes a combined buffer as the next run
+  void write_run(const vector<PositionEntry> &v) {
+    string path;
+    {
+      lock_guard<mutex> lock(runs_mutex);
+      path = temp_path("run", runs.size());
+      runs.push_back(path);
+    }
+    FILE *f = fopen(path.c_str(), "wb");
+    bool ok = f && write_entries(f, v.data(), v.size());
+    if (f && fclose(f) != 0)
+      ok = false;
+    if (!ok) {
+      perror(path.c_str());
+      lock_guard<mutex> lock(runs_mutex);
+      failed = true;
+    }
+  }
+
+  // Phase 1: reads the records of every path into sorted runs. Lines are
+  // read on this thread in batches and parsed, replayed and keyed on the
+  // workers.
+  bool collect(const vector<string> &paths) {
+    const size_t batch_lines = 1024;
+    size_t capacity =
+        max<size_t>(1024, memory_bytes / threads / sizeof(PositionEntry));
+    mutex queue_mutex;
+    condition_variable ready, space;
+    deque<vector<string>> queue;
+    bool done = false;
+    atomic<uint64_t> game_count{0}, bad_count{0}, position_count{0};
+
+    auto work = [&] {
+      vector<PositionEntry> buf;
+      buf.reserve(capacity);
+      while (true) {
+        vector<string> batch;
+        {
+          unique_lock<mutex> lock(queue_mutex);
+          ready.wait(lock, [&] { return done || !queue.empty(); });
+          if (queue.empty())
+            break;
+          batch = move(queue.front());
+          queue.pop_front();
+        }
+        space.notify_one();
+        uint64_t n_games = 0, n_bad = 0, n_positions = 0;
+        for (const string &line : batch) {
+          istringstream in(line);
+          GameRecord rec;
+          if (!read_record(in, rec)) {
+            n_bad += !line.empty() && line[0] != '#';
+            continue;
+          }
+          ++n_games;
+          uint32_t x = rec.result == 1, o = rec.result == -1;
+          int ply = 0;
+          replay_record(rec, [&](const State &st, const pair<int, int> &) {
+            if (ply++ < skip_plies)
+              return;
+            buf.push_back({canonical_key(st), 1, x, o});
+            ++n_positions;
+            if (buf.size() == capacity) {
+              combine_positions(buf);
+              if (buf.size() > capacity / 2) {
+                write_run(buf);
+                buf.clear();
+              }
+            }
+          });
+        }
+        game_count += n_games;
+        bad_count += n_bad;
+        position_count += n_positions;
+      }
+      if (!buf.empty()) {
+        combine_positions(buf);
+        write_run(buf);
+      }
+    };
+
+    vector<thread> workers;
+    for (int t = 0; t < threads; ++t)
+      workers.emplace_back(work);
+    bool ok = true;
+    for (const string &path : paths) {
+      ifstream in(path);
+      if (!in) {
+        cerr << "cannot read " << path << endl;
+        ok = false;
+        break;
+      }
+      vector<string> batch;
+      for (string line; getline(in, line);) {
+        batch.push_back(move(line));
+        if (batch.size() < batch_lines)
+          continue;
+        unique_lock<mutex> lock(queue_mutex);
+        space.wait(lock, [&] { return queue.size() < size_t(2 * threads); });
+        queue.push_back(move(batch));
+        batch.clear();
+        ready.notify_one();
+      }
+      if (!batch.empty()) {
+        lock_guard<mutex> lock(queue_mutex);
+        queue.push_back(move(batch));
+        ready.notify_one();
+      }
+    }
+    {
+      lock_guard<mutex> lock(queue_mutex);
+      done = true;
+    }
+    ready.notify_all();
+    for (thread &w : workers)
+      w.join();
+    games = game_count;
+    bad_lines = bad_count;
+    positions = position_count;
+    return ok && !failed;
+  }
+
+  // Phase 2: merges the runs into out_path
+  bool merge(const string &out_path) {
+    vector<MappedFile> mapped(runs.size());
+    vector<pair<const PositionEntry *, const PositionEntry *>> spans;
+    for (size_t r = 0; r < runs.size(); ++r) {
+      if (!mapped[r].map(runs[r]))
+        return false;
+      auto *e = reinterpret_cast<const PositionEntry *>(mapped[r].data());
+      spans.push_back({e, e + mapped[r].bytes / sizeof(PositionEntry)});
+    }
+
+    // One key range per thread, cut at quantiles of a sample of every run
+    vector<PositionKey> sample;
+    for (auto &span : spans) {
+      size_t n = span.second - span.first;
+      size_t step = max<size_t>(1, n / (64 * size_t(threads)));
+      for (size_t i = step / 2; i < n; i += step)
+        sample.push_back(span.first[i].key);
+    }
+    sort(sample.begin(), sample.end());
+    vector<PositionKey> splitters;
+    for (int p = 1; p < threads && !sample.empty(); ++p)
+      splitters.push_back(sample[sample.size() * p / threads]);
+    int parts = static_cast<int>(splitters.size()) + 1;
+
+    vector<string> part_paths(parts);
+    vector<uint64_t> part_count(parts, 0);
+    atomic<bool> ok{true};
+    auto merge_part = [&](int p) {
+      auto below = [](const PositionEntry &e, const PositionKey &k) {
+        return e.key < k;
+      };
+      vector<pair<const PositionEntry *, const PositionEntry *>> cursors;
+      for (auto &span : spans) {
+        const PositionEntry *lo = span.first, *hi = span.second;
+        if (p > 0)
+          lo = lower_bound(lo, hi, splitters[p - 1], below);
+        if (p + 1 < parts)
+          hi = lower_bound(lo, hi, splitters[p], below);
+        if (lo < hi)
+          cursors.push_back({lo, hi});
+      }
+      auto later = [&](int a, int b) {
+        return cursors[b].first->key < cursors[a].first->key;
+      };
+      priority_queue<int, vector<int>, decltype(later)> heap(later);
+      for (size_t c = 0; c < cursors.size(); ++c)
+        heap.push(static_cast<int>(c));
+
+      part_paths[p] = temp_path("part", p);
+      FILE *f = fopen(part_paths[p].c_str(), "wb");
+      if (!f) {
+        perror(part_paths[p].c_str());
+        ok = false;
+        return;
+      }
+      vector<PositionEntry> out;
+      out.reserve(1 << 16);
+      PositionEntry cur{};
+      bool have = false;
+      auto emit = [&] {
+        if (have && cur.visits >= min_visits) {
+          out.push_back(cur);
+          ++part_count[p];
+          if (out.size() == out.capacity()) {
+            ok = ok && write_entries(f, out.data(), out.size());
+            out.clear();
+          }
+        }
+      };
+      while (!heap.empty()) {
+        int c = heap.top();
+        heap.pop();
+        const PositionEntry &e = *cursors[c].first++;
+        if (have && cur.key == e.key) {
+          cur.visits += e.visits;
+          cur.x_wins += e.x_wins;
+          cur.o_wins += e.o_wins;
+        } else {
+          emit();
+          cur = e;
+          have = true;
+        }
+        if (cursors[c].first < cursors[c].second)
+          heap.push(c);
+      }
+      emit();
+      ok = ok && write_entries(f, out.data(), out.size());
+      if (fclose(f) != 0)
+        ok = false;
+    };
+    vector<thread> workers;
+    for (int p = 0; p < parts; ++p)
+      workers.emplace_back(merge_part, p);
+    for (thread &w : workers)
+      w.join();
+    for (MappedFile &m : mapped)
+      m.unmap();
+    for (const string &path : runs)
+      remove(path.c_str());
+    runs.clear();
+
+    // The ranges are disjoint and in key order, so the parts concatenate
+    unique = 0;
+    for (uint64_t n : part_count)
+      unique += n;
+    FILE *out = ok ? fopen(out_path.c_str(), "wb") : nullptr;
+    if (ok && !out)
+      perror(out_path.c_str());
+    bool written = out != nullptr;
+    if (out) {
+      uint8_t header[POSITION_HEADER_BYTES];
+      position_header(header, unique);
+      written = fwrite(header, 1, sizeof(header), out) == sizeof(header);
+    }
+    vector<char> chunk(1 << 20);
+    for (const string &path : part_paths) {
+      FILE *in = written && !path.empty() ? fopen(path.c_str(), "rb") : nullptr;
+      for (size_t n; in && (n = fread(chunk.data(), 1, chunk.size(), in));)
+        written = written && fwrite(chunk.data(), 1, n, out) == n;
+      if (in)
+        fclose(in);
+      if (!path.empty())
+        remove(path.c_str());
+    }
+    if (out && fclose(out) != 0)
+      written = false;
+    if (out && !written)
+      perror(out_path.c_str());
+    return written;
+  }
+};
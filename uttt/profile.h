@@ -0,0 +1,141 @@
+#pragma once
+// Game-phase profile: per-ply statistics of random games.
+//
+// Plays many uniformly random games (the same playouts MCTS runs) and
+// reports, for each ply, how many games are still running, the average
+// branching factor, how often the side to move has a free choice
+// (sub_idx == 9), how often a move closes a sub-board, how many sub-boards
+// are closed, and how many games end there. Positions sampled at each ply
+// are then replayed in batches to time get_valid_moves and apply_move.
+//
+//   profile [games] [--seed N] [--samples N] [--format csv|json]
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "flags.h"
+#include "state.h"
+
+struct PlyStats {
+  long positions = 0;   // running games with this many moves played
+  long moves = 0;       // legal moves summed over those positions
+  long free_choice = 0; // positions with sub_idx == 9
+  long closures = 0;    // moves played here that closed a sub-board
+  long closed = 0;      // closed sub-boards summed over positions
+  long ended = 0;       // games whose final position has this many moves
+  double valid_ns = 0;  // get_valid_moves, per call
+  double apply_ns = 0;  // apply_move, per call
+  vector<pair<State, pair<int, int>>> samples; // position, move played
+};
+
+// Nanoseconds per call of fn over the samples, repeated to ~reps calls
+template <class F>
+double time_per_call(const vector<pair<State, pair<int, int>>> &samples,
+                     long reps, F fn) {
+  if (samples.empty())
+    return 0.0;
+  long rounds = max(1L, reps / static_cast<long>(samples.size()));
+  auto start = chrono::steady_clock::now();
+  for (long r = 0; r < rounds; ++r)
+    for (const auto &s : samples)
+      fn(s);
+  chrono::duration<double, nano> t = chrono::steady_clock::now() - start;
+  return t.count() / (rounds * samples.size());
+}
+
+inline int run_profile(const Flags &flags) {
+  long games =
+      flags.positional.empty() ? 100000 : atol(flags.positional[0].c_str());
+  size_t max_samples = flags.get("samples", 2048);
+  string format = flags.get("format", "csv");
+  mt19937 rng(flags.get("seed", 1));
+
+  vector<PlyStats> plies(82);
+  long x_wins = 0, o_wins = 0, draws = 0;
+  for (long g = 0; g < games; ++g) {
+    State st;
+    int ply = 0;
+    while (!st.is_terminal()) {
+      PlyStats &p = plies[ply];
+      auto moves = st.get_valid_moves();
+      int closed_before = __builtin_popcount(st.metaX | st.metaO | st.metaD);
+      p.positions++;
+      p.moves += moves.size();
+      p.free_choice += st.sub_idx == 9;
+      p.closed += closed_before;
+      auto mv = moves[uniform_int_distribution<size_t>(0, moves.size() - 1)(
+          rng)];
+      if (p.samples.size() < max_samples)
+        p.samples.push_back({st, mv});
+      st.apply_move(mv);
+      p.closures +=
+          __builtin_popcount(st.metaX | st.metaO | st.metaD) > closed_before;
+      ++ply;
+    }
+    plies[ply].ended++;
+    int w = st.get_winner();
+    (w == 1 ? x_wins : w == -1 ? o_wins : draws)++;
+  }
+
+  // Batch timing; the state copy is measured separately and subtracted
+  const long reps = 200000;
+  long sink = 0;
+  for (PlyStats &p : plies) {
+    p.valid_ns = time_per_call(p.samples, reps, [&](const auto &s) {
+      sink += s.first.get_valid_moves().size();
+    });
+    double copy_ns = time_per_call(p.samples, reps, [&](const auto &s) {
+      State st = s.first;
+      sink += st.hash & 1;
+    });
+    p.apply_ns = time_per_call(p.samples, reps, [&](const auto &s) {
+      State st = s.first;
+      st.apply_move(s.second);
+      sink += st.hash & 1;
+    }) - copy_ns;
+  }
+  if (sink == -1) // keeps the timed calls from being optimised out
+    cerr << sink;
+
+  auto ratio = [](long a, long b) { return b ? double(a) / b : 0.0; };
+  int last = 81;
+  while (last > 0 && plies[last].positions == 0 && plies[last].ended == 0)
+    --last;
+  if (format == "json") {
+    cout << "{\"games\": " << games << ", \"x_wins\": " << x_wins
+         << ", \"o_wins\": " << o_wins << ", \"draws\": " << draws
+         << ", \"plies\": [";
+    for (int k = 0; k <= last; ++k) {
+      const PlyStats &p = plies[k];
+      cout << (k ? ",\n  " : "\n  ") << "{\"ply\": " << k
+           << ", \"positions\": " << p.positions
+           << ", \"branching\": " << ratio(p.moves, p.positions)
+           << ", \"free_choice\": " << ratio(p.free_choice, p.positions)
+           << ", \"closure_rate\": " << ratio(p.closures, p.positions)
+           << ", \"closed_boards\": " << ratio(p.closed, p.positions)
+           << ", \"ended\": " << p.ended << ", \"valid_moves_ns\": "
+           << p.valid_ns << ", \"apply_move_ns\": " << p.apply_ns << "}";
+    }
+    cout << "\n]}" << endl;
+  } else {
+    cout << "ply,positions,branching,free_choice,closure_rate,"
+            "closed_boards,ended,valid_moves_ns,apply_move_ns\n";
+    for (int k = 0; k <= last; ++k) {
+      const PlyStats &p = plies[k];
+      cout << k << "," << p.positions << "," << ratio(p.moves, p.positions)
+           << "," << ratio(p.free_choice, p.positions) << ","
+           << ratio(p.closures, p.positions) << ","
+           << ratio(p.closed, p.positions) << "," << p.ended << ","
+           << p.valid_ns << "," << p.apply_ns << "\n";
+    }
+    cout << flush;
+  }
+  cerr << games << " games: X " << ratio(x_wins, games) << ", O "
+       << ratio(o_wins, games) << ", draw " << ratio(draws, games) << endl;
+  return 0;
+}
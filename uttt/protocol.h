@@ -0,0 +1,122 @@
+#pragma once
+// CodinGame referee protocol and turn timing, for any Searcher.
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <utility>
+#include <vector>
+
+#include "alloc.h"
+#include "engines.h"
+#include "heuristic.h"
+#include "searcher.h"
+#include "state.h"
+#include "watchdog.h"
+
+// ----------------------------------------------------------------------
+// Time Manager
+// ----------------------------------------------------------------------
+// CodinGame allows 1 s for the first answer and 0.1 s for every later one,
+// measured from when the opponent's move is sent. The search stops
+// SEARCH_MARGIN early and the watchdog answers WATCHDOG_MARGIN early.
+//
+// After answering, the bot tidies its search (Searcher::tidy, tree
+// compaction for MCTS: about 1 ms, up to 15 ms late in the middlegame)
+// before it reads the next move. A quick opponent's move waits behind that,
+// so the turn is taken to have started as early as the tidy began: its
+// duration counts against the next turn, less the time spent waiting for
+// the input after it ended.
+struct TimeManager {
+  double first_turn = 1.0;
+  double other_turns = 0.1;
+  bool first = true;
+  chrono::steady_clock::time_point tidy_end;
+  double tidy_seconds = 0;
+
+  struct Turn {
+    chrono::steady_clock::time_point search_deadline, watchdog_deadline;
+  };
+
+  void tidied(chrono::steady_clock::time_point begin,
+              chrono::steady_clock::time_point end) {
+    tidy_end = end;
+    tidy_seconds = chrono::duration<double>(end - begin).count();
+  }
+
+  // start is when the opponent's move was read
+  Turn start_turn(chrono::steady_clock::time_point start) {
+    double limit = first ? first_turn : other_turns;
+    first = false;
+    double waited = chrono::duration<double>(start - tidy_end).count();
+    limit -= max(0.0, tidy_seconds - waited);
+    tidy_seconds = 0;
+    auto at = [&](double seconds) {
+      return start + chrono::duration_cast<chrono::steady_clock::duration>(
+                         chrono::duration<double>(seconds));
+    };
+    return {at(limit - SEARCH_MARGIN), at(limit - WATCHDOG_MARGIN)};
+  }
+};
+
+// ----------------------------------------------------------------------
+// CodinGame Game Loop
+// ----------------------------------------------------------------------
+inline int run_codingame(Searcher &searcher) {
+  State state;
+  TimeManager clock;
+  Watchdog watchdog;
+  searcher.set_position(state);
+
+  while (true) {
+    int opp_r, opp_c;
+    if (!(cin >> opp_r >> opp_c))
+      break;
+    auto start = chrono::steady_clock::now();
+    int valid_count;
+    cin >> valid_count;
+    vector<pair<int, int>> valid_moves(valid_count);
+    for (int i = 0; i < valid_count; ++i)
+      cin >> valid_moves[i].first >> valid_moves[i].second;
+
+    if (opp_r != -1)
+      state.apply_move({opp_r, opp_c});
+    // Armed before advance, whose fallback to a fresh tree frees the old one
+    TimeManager::Turn turn = clock.start_turn(start);
+    watchdog.arm(turn.watchdog_deadline, heuristic_move(state, valid_moves));
+    if (opp_r != -1)
+      searcher.advance({opp_r, opp_c});
+
+    eval_cache().clear_stats();
+    SearchLimits limits;
+    limits.deadline = turn.search_deadline;
+    limits.abort = &watchdog.abandon;
+    limits.publish = [&](pair<int, int> mv) { watchdog.publish(mv); };
+    AllocCounts before = alloc_counts();
+    searcher.search(limits);
+    AllocCounts allocs = alloc_counts() - before;
+
+    pair<int, int> best_move = searcher.best_move();
+    if (best_move.first < 0)
+      best_move = heuristic_move(state, valid_moves);
+
+    bool ours = watchdog.claim();
+    watchdog.disarm();
+    if (ours)
+      cout << best_move.first << " " << best_move.second << endl;
+    else
+      best_move = {watchdog.emitted_cell / 9, watchdog.emitted_cell % 9};
+    cerr << searcher.name() << ": ";
+    print_stats(cerr, searcher.stats());
+    print_allocs(cerr, allocs);
+    cerr << endl;
+    if (!ours)
+      cerr << "Watchdog answered (" << watchdog.fired << " so far)" << endl;
+    state.apply_move(best_move);
+    searcher.advance(best_move);
+    auto tidy_start = chrono::steady_clock::now();
+    searcher.tidy(); // the answer is out, the opponent's clock is running
+    clock.tidied(tidy_start, chrono::steady_clock::now());
+  }
+  return 0;
+}
@@ -0,0 +1,69 @@
+#pragma once
+// Self-play game records.
+//
+// Text, one game per line: the result from X's point of view (1, 0 or -1)
+// followed by the cells played, r * 9 + c, in order. Lines starting with '#'
+// are comments. The selfplay mode writes it and train-policy reads it; it
+// is also easy to produce or consume from scripts:
+//   # mcts --iterations 2000
+//   1 40 36 4 44 ...
+
+#include <algorithm>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "state.h"
+
+struct GameRecord {
+  int result = 0;     // 1 = X won, -1 = O won, 0 = draw
+  vector<int> cells;  // moves in play order, r * 9 + c
+};
+
+inline void write_record(ostream &out, const GameRecord &rec) {
+  out << rec.result;
+  for (int c : rec.cells)
+    out << " " << c;
+  out << "\n";
+}
+
+// Next record from in, skipping comments and blank lines; false at the end
+// of input or on a malformed line (an illegal move or a bad result)
+inline bool read_record(istream &in, GameRecord &rec) {
+  string line;
+  while (getline(in, line)) {
+    if (line.empty() || line[0] == '#')
+      continue;
+    istringstream fields(line);
+    rec = GameRecord();
+    if (!(fields >> rec.result) || rec.result < -1 || rec.result > 1)
+      return false;
+    State st;
+    State::MoveList legal;
+    for (int c; fields >> c;) {
+      if (st.is_terminal())
+        return false;
+      st.get_valid_moves(legal);
+      if (find(legal.begin(), legal.end(), make_pair(c / 9, c % 9)) ==
+          legal.end())
+        return false;
+      st.apply_move({c / 9, c % 9});
+      rec.cells.push_back(c);
+    }
+    return true;
+  }
+  return false;
+}
+
+// Replays rec, calling fn(state, move) for every position before its move
+template <class F> void replay_record(const GameRecord &rec, F fn) {
+  State st;
+  for (int c : rec.cells) {
+    pair<int, int> mv = {c / 9, c % 9};
+    fn(static_cast<const State &>(st), mv);
+    st.apply_move(mv);
+  }
+}
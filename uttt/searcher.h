@@ -0,0 +1,109 @@
+#pragma once
+// Common interface of the search engines.
+//
+// A Searcher owns a position and thinks about it within the limits it is
+// given. The protocol loop, the benchmarks and the analysis tools only talk
+// to this interface, so a new engine gets all of them by implementing it.
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <utility>
+
+#include "state.h"
+
+using namespace std;
+
+// What a single search() may spend. Every limit that is set applies.
+struct SearchLimits {
+  chrono::steady_clock::time_point deadline =
+      chrono::steady_clock::time_point::max();
+  long iterations = 0;                 // 0 = unlimited
+  const atomic<bool> *abort = nullptr; // external stop, e.g. the watchdog
+  function<void(pair<int, int>)> publish; // best move so far, may be empty
+};
+
+// Telemetry of the last search; fields an engine does not track stay 0
+// (value stays negative).
+// Engines bring iterations, nodes and value up to date before each publish,
+// so a publish callback can report the search in progress.
+struct SearchStats {
+  long iterations = 0;       // playouts (MCTS) or nodes visited (alpha-beta)
+  size_t nodes = 0;          // search tree size
+  int depth = 0;             // last completed alpha-beta depth
+  long reused = 0;           // root visits inherited from earlier searches
+  double seconds = 0;        // wall time of the search
+  double bytes_per_node = 0; // tree memory per node
+  double tidy_ms = 0;        // housekeeping since the previous search
+  double value = -1;         // best move's expected result for the mover,
+                             // 0-1, or negative when the engine has none
+};
+
+struct Searcher {
+  State root;                   // position being searched
+  SearchStats last;             // telemetry of the last search
+  atomic<bool> stopping{false}; // set by stop()
+
+  virtual ~Searcher() = default;
+
+  virtual const char *name() const = 0;
+
+  // Start over from st, dropping anything learnt so far
+  virtual void set_position(const State &st) { root = st; }
+
+  // Reuse hint: the position moved on by mv. Engines that can keep work
+  // from the previous search override this.
+  virtual void advance(const pair<int, int> &mv) {
+    State next = root.copy();
+    next.apply_move(mv);
+    set_position(next);
+  }
+
+  // Housekeeping for time that is not on the clock, e.g. right after the
+  // answer has been sent while the opponent thinks
+  virtual void tidy() {}
+
+  // Think until a limit is hit or stop() is called. Clears the stop flag
+  // on entry.
+  virtual void search(const SearchLimits &limits) = 0;
+
+  // Safe to call from another thread while search() runs
+  virtual void stop() { stopping.store(true, memory_order_relaxed); }
+
+  // {-1, -1} if the search has produced nothing yet
+  virtual pair<int, int> best_move() const = 0;
+
+  const SearchStats &stats() const { return last; }
+};
+
+// Tracks one search() call against its limits
+struct SearchBudget {
+  const SearchLimits &limits;
+  const atomic<bool> &stopping;
+  chrono::steady_clock::time_point start;
+  long used = 0; // iterations spent
+
+  SearchBudget(const SearchLimits &lim, const atomic<bool> &stop)
+      : limits(lim), stopping(stop), start(chrono::steady_clock::now()) {}
+
+  bool exhausted() const {
+    if (stopping.load(memory_order_relaxed))
+      return true;
+    if (limits.abort && limits.abort->load(memory_order_relaxed))
+      return true;
+    if (limits.iterations > 0 && used >= limits.iterations)
+      return true;
+    return chrono::steady_clock::now() >= limits.deadline;
+  }
+
+  double elapsed() const {
+    return chrono::duration<double>(chrono::steady_clock::now() - start)
+        .count();
+  }
+
+  void publish(pair<int, int> mv) const {
+    if (limits.publish && mv.first >= 0)
+      limits.publish(mv);
+  }
+};
@@ -0,0 +1,204 @@
+#pragma once
+// Whole games between Searchers: self-play records and engine matches.
+//
+//   selfplay GAMES [--out PATH] [--iterations N] [--random-plies N]
+//       [--seed N] [engine options]
+//   arena GAMES [--a OPTIONS] [--b OPTIONS] [--time S | --iterations N]
+//       [--random-plies N] [--seed N]
+//
+// selfplay writes records (see records.h) of one engine playing itself
+// with a fixed number of iterations per move. arena plays two engine
+// configurations against each other in pairs of games, one with each
+// colour from the same opening, and reports the first one's score. OPTIONS
+// is one quoted string of make_searcher flags, e.g. --a "--playout policy".
+// Both modes open with --random-plies uniformly random moves so that the
+// games differ; selfplay records them too, and train-policy can skip them.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "engines.h"
+#include "evalcache.h"
+#include "flags.h"
+#include "records.h"
+#include "searcher.h"
+#include "state.h"
+
+// Uniformly random opening of the given length
+inline vector<pair<int, int>> random_opening(int plies, mt19937 &rng) {
+  State st;
+  vector<pair<int, int>> line;
+  for (int i = 0; i < plies && !st.is_terminal(); ++i) {
+    auto moves = st.get_valid_moves();
+    line.push_back(moves[rng() % moves.size()]);
+    st.apply_move(line.back());
+  }
+  return line;
+}
+
+inline SearchLimits move_limits(double seconds, long iterations) {
+  SearchLimits limits;
+  limits.iterations = iterations;
+  if (iterations == 0)
+    limits.deadline = chrono::steady_clock::now() +
+                      chrono::duration_cast<chrono::steady_clock::duration>(
+                          chrono::duration<double>(seconds));
+  return limits;
+}
+
+// ----------------------------------------------------------------------
+// Self-play records
+// ----------------------------------------------------------------------
+inline int run_selfplay(const Flags &flags) {
+  long games =
+      flags.positional.empty() ? 100 : atol(flags.positional[0].c_str());
+  long iterations = flags.get("iterations", 2000);
+  int random_plies = flags.get("random-plies", 2);
+  Flags options = flags;
+  if (!options.has("seed"))
+    options.values["seed"] = "1";
+  unique_ptr<Searcher> searcher = make_searcher(options);
+  if (!searcher) {
+    cerr << "unknown engine " << flags.get("engine", "") << endl;
+    return 1;
+  }
+  ofstream file;
+  string path = flags.get("out", "-");
+  if (path != "-") {
+    file.open(path, ios::app);
+    if (!file) {
+      cerr << "cannot write " << path << endl;
+      return 1;
+    }
+  }
+  ostream &out = path == "-" ? cout : file;
+  eval_cache().resize(flags.get("eval-cache-mb", DEFAULT_EVAL_CACHE_MB));
+  mt19937 rng(options.get("seed", 1));
+
+  out << "# selfplay " << searcher->name() << " --iterations " << iterations
+      << " --random-plies " << random_plies << "\n";
+  int score[3] = {0, 0, 0}; // O wins, draws, X wins
+  auto start = chrono::steady_clock::now();
+  for (long g = 0; g < games; ++g) {
+    GameRecord rec;
+    searcher->set_position(State());
+    for (const auto &mv : random_opening(random_plies, rng)) {
+      searcher->advance(mv);
+      rec.cells.push_back(mv.first * 9 + mv.second);
+    }
+    while (!searcher->root.is_terminal()) {
+      searcher->search(move_limits(0, iterations));
+      pair<int, int> mv = searcher->best_move();
+      if (mv.first < 0) // nothing searched: fall back to the first move
+        mv = searcher->root.get_valid_moves()[0];
+      searcher->advance(mv);
+      searcher->tidy();
+      rec.cells.push_back(mv.first * 9 + mv.second);
+    }
+    rec.result = searcher->root.get_winner();
+    write_record(out, rec);
+    out.flush();
+    score[rec.result + 1]++;
+    if ((g + 1) % 10 == 0 || g + 1 == games) {
+      chrono::duration<double> t = chrono::steady_clock::now() - start;
+      cerr << g + 1 << " games, X " << score[2] << ", O " << score[0]
+           << ", draws " << score[1] << ", " << t.count() / (g + 1)
+           << " s/game" << endl;
+    }
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------
+// Arena
+// ----------------------------------------------------------------------
+// Plays one game from opening; returns the result from X's point of view
+inline int play_game(Searcher &x, Searcher &o,
+                     const vector<pair<int, int>> &opening, double seconds,
+                     long iterations, long moves[2], long spent[2]) {
+  Searcher *side[2] = {&x, &o};
+  State st;
+  for (Searcher *s : side)
+    s->set_position(st);
+  for (const auto &mv : opening) {
+    st.apply_move(mv);
+    for (Searcher *s : side)
+      s->advance(mv);
+  }
+  while (!st.is_terminal()) {
+    int turn = st.turnX ? 0 : 1;
+    Searcher &s = *side[turn];
+    s.search(move_limits(seconds, iterations));
+    pair<int, int> mv = s.best_move();
+    if (mv.first < 0) // nothing searched: fall back to the first move
+      mv = st.get_valid_moves()[0];
+    moves[turn]++;
+    spent[turn] += s.stats().iterations;
+    st.apply_move(mv);
+    for (Searcher *p : side) {
+      p->advance(mv);
+      p->tidy();
+    }
+  }
+  return st.get_winner();
+}
+
+inline int run_arena(const Flags &flags) {
+  long games =
+      flags.positional.empty() ? 100 : atol(flags.positional[0].c_str());
+  double seconds = flags.get("time", 0.1);
+  long iterations = flags.get("iterations", 0);
+  int random_plies = flags.get("random-plies", 2);
+  unsigned seed = static_cast<unsigned>(flags.get("seed", 1));
+  Flags a_flags(flags.get("a", "")), b_flags(flags.get("b", ""));
+  for (Flags *f : {&a_flags, &b_flags})
+    if (!f->has("seed"))
+      f->values["seed"] = to_string(seed++);
+  unique_ptr<Searcher> a = make_searcher(a_flags), b = make_searcher(b_flags);
+  if (!a || !b) {
+    cerr << "unknown engine " << (a ? b_flags : a_flags).get("engine", "")
+         << endl;
+    return 1;
+  }
+  eval_cache().resize(flags.get("eval-cache-mb", DEFAULT_EVAL_CACHE_MB));
+  mt19937 rng(seed);
+
+  long wins = 0, draws = 0, losses = 0;
+  long moves[2] = {0, 0}, spent[2] = {0, 0}; // [0] = A, [1] = B
+  vector<pair<int, int>> opening;
+  for (long g = 0; g < games; ++g) {
+    if (g % 2 == 0)
+      opening = random_opening(random_plies, rng);
+    bool a_is_x = g % 2 == 0;
+    long m[2] = {0, 0}, s[2] = {0, 0}; // [0] = X, [1] = O
+    int result = a_is_x ? play_game(*a, *b, opening, seconds, iterations, m, s)
+                        : play_game(*b, *a, opening, seconds, iterations, m, s);
+    int for_a = a_is_x ? result : -result;
+    (for_a > 0 ? wins : for_a < 0 ? losses : draws)++;
+    for (int k = 0; k < 2; ++k) {
+      moves[k] += m[a_is_x ? k : 1 - k];
+      spent[k] += s[a_is_x ? k : 1 - k];
+    }
+    cerr << "game " << g + 1 << ": A " << wins << " - " << losses
+         << " B, draws " << draws << endl;
+  }
+  // Score of A with a 95% interval from the per-game score variance
+  double n = max(1L, games);
+  double score = (wins + 0.5 * draws) / n;
+  double var = (wins + 0.25 * draws) / n - score * score;
+  double ci = 1.96 * sqrt(max(0.0, var) / n);
+  cout << "A: " << a->name() << " " << flags.get("a", "") << "\nB: "
+       << b->name() << " " << flags.get("b", "") << "\ngames " << games
+       << ", A wins " << wins << ", draws " << draws << ", B wins " << losses
+       << ", A score " << score << " +- " << ci
+       << ", iterations/move A " << (moves[0] ? spent[0] / moves[0] : 0)
+       << ", B " << (moves[1] ? spent[1] / moves[1] : 0) << endl;
+  return 0;
+}
@@ -0,0 +1,209 @@
+#pragma once
+// Ultimate Tic-Tac-Toe rules on bitboards.
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "geometry.h"
+
+using namespace std;
+
+// ----------------------------------------------------------------------
+// Bitboard Constants
+// ----------------------------------------------------------------------
+static const int FILLED_MASK = 0x1FF; // lower 9 bits set
+// Rows, columns, then the two diagonals (bit = row * 3 + col):
+//   0x7, 0x38, 0x1C0, 0x49, 0x92, 0x124, 0x111, 0x54
+static constexpr array<int, 8> WIN_LINES = make_win_lines();
+// Base-3 value of each sub-board side mask
+static constexpr array<uint16_t, 512> TERNARY = make_ternary();
+
+// ----------------------------------------------------------------------
+// Zobrist Keys
+// ----------------------------------------------------------------------
+// One key per (cell, side), per sub_idx value (0-9) and for O to move,
+// drawn from splitmix64 at compile time. The meta boards and the winner
+// follow from the stones, so they need no keys of their own.
+struct ZobristKeys {
+  array<array<uint64_t, 2>, 81> stone; // [s * 9 + pos][0 = X, 1 = O]
+  array<uint64_t, 10> sub_idx;
+  uint64_t o_to_move;
+};
+
+constexpr uint64_t splitmix64(uint64_t &x) {
+  uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+constexpr ZobristKeys make_zobrist_keys() {
+  ZobristKeys keys{};
+  uint64_t seed = 0x5A0B2157ULL;
+  for (auto &cell : keys.stone)
+    for (auto &k : cell)
+      k = splitmix64(seed);
+  for (auto &k : keys.sub_idx)
+    k = splitmix64(seed);
+  keys.o_to_move = splitmix64(seed);
+  return keys;
+}
+
+static constexpr ZobristKeys ZOBRIST = make_zobrist_keys();
+
+// ----------------------------------------------------------------------
+// Game State with Bit Encoding
+// ----------------------------------------------------------------------
+struct State {
+  static constexpr int SIDE = 9; // cells per row
+
+  // Each sub-board: lower 9 bits for X, next 9 bits for O
+  array<int, 9> sub;
+  int sub_idx; // which sub-board to play (0–8), or 9 = any
+  bool turnX;  // true = X to play, false = O
+
+  // Meta boards: bitmask of won (or drawn) sub-boards
+  int metaX, metaO, metaD;
+  int winner; // 0 = ongoing, 1=X wins, -1=O wins, 2=draw
+  uint64_t hash; // Zobrist key, kept up to date by apply_move
+
+  State()
+      : sub{}, sub_idx(9), turnX(true), metaX(0), metaO(0), metaD(0),
+        winner(0), hash(ZOBRIST.sub_idx[9]) {}
+  State copy() const { return *this; }
+
+  // Zobrist key recomputed from scratch; equals hash for any reachable state
+  uint64_t compute_hash() const {
+    uint64_t h = ZOBRIST.sub_idx[sub_idx];
+    if (!turnX)
+      h ^= ZOBRIST.o_to_move;
+    for (int s = 0; s < 9; ++s)
+      for (int pos = 0; pos < 9; ++pos) {
+        if ((sub[s] >> pos) & 1)
+          h ^= ZOBRIST.stone[s * 9 + pos][0];
+        if ((sub[s] >> (pos + 9)) & 1)
+          h ^= ZOBRIST.stone[s * 9 + pos][1];
+      }
+    return h;
+  }
+
+  // Check if bitmask m has any winning line
+  static bool isWin(int m) {
+    for (int w : WIN_LINES)
+      if ((m & w) == w)
+        return true;
+    return false;
+  }
+
+  using MoveList = FixedMoves<81>;
+
+  // Generate all valid moves respecting the last sub_idx (const-safe)
+  vector<pair<int, int>> get_valid_moves() const {
+    MoveList moves;
+    get_valid_moves(moves);
+    return {moves.begin(), moves.end()};
+  }
+
+  // Same, into a fixed-capacity list that never allocates
+  void get_valid_moves(MoveList &moves) const {
+    moves.count = 0;
+    auto add_moves = [&](int s) {
+      int xb = sub[s] & FILLED_MASK;
+      int ob = (sub[s] >> 9) & FILLED_MASK;
+      int filled = xb | ob;
+      for (int i = 0; i < 9; ++i) {
+        if (!(filled & (1 << i))) {
+          int r = (s / 3) * 3 + i / 3;
+          int c = (s % 3) * 3 + i % 3;
+          moves.push(r, c);
+        }
+      }
+    };
+
+    int targetIndex = sub_idx;
+    if (targetIndex < 9) {
+      bool closed = ((metaX | metaO | metaD) >> targetIndex) & 1;
+      int xb = sub[targetIndex] & FILLED_MASK;
+      int ob = (sub[targetIndex] >> 9) & FILLED_MASK;
+      bool full = ((xb | ob) == FILLED_MASK);
+      if (closed || full)
+        targetIndex = 9;
+    }
+    if (targetIndex == 9) {
+      for (int s = 0; s < 9; ++s) {
+        if (((metaX | metaO | metaD) >> s) & 1)
+          continue;
+        add_moves(s);
+      }
+    } else {
+      add_moves(targetIndex);
+    }
+  }
+
+  // Apply a move and update sub/meta boards and next player
+  void apply_move(const pair<int, int> &mv) {
+    auto [r, c] = mv;
+    int s = (r / 3) * 3 + (c / 3);
+    int pos = (r % 3) * 3 + (c % 3);
+    if (turnX)
+      sub[s] |= 1 << pos;
+    else
+      sub[s] |= 1 << (pos + 9);
+    hash ^= ZOBRIST.stone[s * 9 + pos][turnX ? 0 : 1];
+
+    // Update sub-board status
+    int xb = sub[s] & FILLED_MASK;
+    int ob = (sub[s] >> 9) & FILLED_MASK;
+    if (!((metaX | metaO | metaD) & (1 << s))) {
+      if (isWin(xb))
+        metaX |= 1 << s;
+      else if (isWin(ob))
+        metaO |= 1 << s;
+      else if ((xb | ob) == FILLED_MASK)
+        metaD |= 1 << s;
+    }
+
+    // Determine overall winner or draw
+    if (isWin(metaX))
+      winner = 1;
+    else if (isWin(metaO))
+      winner = -1;
+    else if (((metaX | metaO | metaD) == ((1 << 9) - 1))) {
+      // No player has 3 aligned, check who won more small boards
+      int x_count = __builtin_popcount(metaX);
+      int o_count = __builtin_popcount(metaO);
+      if (x_count > o_count)
+        winner = 1;
+      else if (o_count > x_count)
+        winner = -1;
+      else
+        winner = 2; // draw
+    }
+
+    // Next sub_idx: target sub-board or any if closed/drawn
+    int target = pos;
+    hash ^= ZOBRIST.sub_idx[sub_idx];
+    if (((metaX | metaO | metaD) >> target) & 1)
+      sub_idx = 9;
+    else
+      sub_idx = target;
+    hash ^= ZOBRIST.sub_idx[sub_idx] ^ ZOBRIST.o_to_move;
+
+    turnX = !turnX;
+  }
+
+  bool is_terminal() const { return winner != 0; }
+
+  int get_winner() const {
+    if (winner == 1)
+      return 1;
+    if (winner == -1)
+      return -1;
+    if (winner == 2)
+      return 0;                        // draw
+    return numeric_limits<int>::min(); // ongoing
+  }
+};
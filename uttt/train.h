@@ -0,0 +1,206 @@
+#pragma once
+// Offline training of the playout policy from self-play records.
+//
+//   train-policy RECORDS... --out PATH [--epochs N] [--rate F] [--l2 F]
+//       [--holdout F] [--skip-plies N] [--init PATH] [--seed N]
+//
+// Fits the pattern and destination weights of policy.h by maximum
+// likelihood of the moves played in the records (softmax over the legal
+// moves of each position), with plain SGD and L2 shrinkage. The last
+// --holdout share of the games is kept out of training; after every epoch
+// the log loss and top-1 accuracy on it are printed next to the uniform
+// policy's loss. --skip-plies leaves out the random opening moves. The
+// quantised weights are checked on the holdout once more and written to
+// --out. Malformed record lines are skipped and counted. --init starts from
+// an earlier blob.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "flags.h"
+#include "policy.h"
+#include "records.h"
+
+// Legal moves of every training position as (pattern class, destination)
+// features, flattened
+struct PolicyDataset {
+  struct Position {
+    uint32_t first;  // index of the first move's features
+    uint8_t count;   // legal moves
+    uint8_t played;  // which of them was played
+  };
+  vector<Position> positions;
+  vector<uint16_t> classes;
+  vector<uint8_t> dests;
+
+  void add(const State &st, const pair<int, int> &mv) {
+    const PatternClasses &pc = pattern_classes();
+    Position p{static_cast<uint32_t>(classes.size()), 0, 0};
+    int played = mv.first * 9 + mv.second;
+    for_each_pattern_move(st, [&](int cell, int pattern, int dest) {
+      if (cell == played)
+        p.played = p.count;
+      classes.push_back(pc.of[pattern]);
+      dests.push_back(static_cast<uint8_t>(dest));
+      p.count++;
+    });
+    positions.push_back(p);
+  }
+};
+
+// Move probabilities of position p under the weights, into prob
+inline void policy_probs(const PolicyDataset &data,
+                         const PolicyDataset::Position &p,
+                         const vector<float> &w,
+                         const array<float, NUM_DEST> &v, double *prob) {
+  double top = -1e30, total = 0;
+  for (int i = 0; i < p.count; ++i) {
+    prob[i] = w[data.classes[p.first + i]] + v[data.dests[p.first + i]];
+    top = max(top, prob[i]);
+  }
+  for (int i = 0; i < p.count; ++i)
+    total += prob[i] = exp(prob[i] - top);
+  for (int i = 0; i < p.count; ++i)
+    prob[i] /= total;
+}
+
+struct PolicyScore {
+  double loss = 0, uniform_loss = 0, accuracy = 0;
+};
+
+inline PolicyScore score_policy(const PolicyDataset &data, size_t begin,
+                                size_t end, const vector<float> &w,
+                                const array<float, NUM_DEST> &v) {
+  PolicyScore sc;
+  double prob[81];
+  for (size_t k = begin; k < end; ++k) {
+    const PolicyDataset::Position &p = data.positions[k];
+    policy_probs(data, p, w, v, prob);
+    sc.loss -= log(max(prob[p.played], 1e-12));
+    sc.uniform_loss += log(double(p.count));
+    sc.accuracy += max_element(prob, prob + p.count) - prob == p.played;
+  }
+  double n = max<size_t>(1, end - begin);
+  sc.loss /= n;
+  sc.uniform_loss /= n;
+  sc.accuracy /= n;
+  return sc;
+}
+
+inline int run_train_policy(const Flags &flags) {
+  if (flags.positional.empty() || !flags.has("out")) {
+    cerr << "usage: train-policy RECORDS... --out PATH" << endl;
+    return 2;
+  }
+  string out_path = flags.get("out", "");
+  int epochs = flags.get("epochs", 8);
+  double rate = flags.get("rate", 0.05);
+  double l2 = flags.get("l2", 1e-5);
+  double holdout = flags.get("holdout", 0.1);
+  int skip = flags.get("skip-plies", 2);
+  mt19937 rng(flags.get("seed", 1));
+
+  vector<GameRecord> games;
+  size_t bad_lines = 0;
+  for (const string &path : flags.positional) {
+    ifstream file(path);
+    if (!file) {
+      cerr << "cannot read " << path << endl;
+      return 1;
+    }
+    for (string line; getline(file, line);) {
+      istringstream in(line);
+      GameRecord rec;
+      if (!read_record(in, rec)) {
+        bad_lines += !line.empty() && line[0] != '#';
+        continue;
+      }
+      games.push_back(rec);
+    }
+  }
+  if (bad_lines)
+    cerr << bad_lines << " malformed lines skipped" << endl;
+  if (games.empty()) {
+    cerr << "no game records" << endl;
+    return 1;
+  }
+  PolicyDataset data;
+  size_t train_games = games.size() - size_t(games.size() * holdout);
+  size_t train_end = 0;
+  for (size_t g = 0; g < games.size(); ++g) {
+    int ply = 0;
+    replay_record(games[g], [&](const State &st, const pair<int, int> &mv) {
+      if (ply++ >= skip)
+        data.add(st, mv);
+    });
+    if (g + 1 == train_games)
+      train_end = data.positions.size();
+  }
+  size_t total = data.positions.size();
+  cerr << games.size() << " games, " << train_end << " training and "
+       << total - train_end << " holdout positions, "
+       << pattern_classes().count << " pattern classes" << endl;
+
+  PlayoutPolicy policy;
+  if (flags.has("init")) {
+    ifstream in(flags.get("init", ""), ios::binary);
+    vector<uint8_t> blob{istreambuf_iterator<char>(in), {}};
+    if (!policy.load(blob)) {
+      cerr << "cannot use " << flags.get("init", "") << " as a start" << endl;
+      return 1;
+    }
+  }
+  vector<float> &w = policy.pattern_weight;
+  array<float, NUM_DEST> v = policy.dest_weight;
+
+  vector<uint32_t> order(train_end);
+  for (size_t k = 0; k < train_end; ++k)
+    order[k] = static_cast<uint32_t>(k);
+  double prob[81];
+  for (int epoch = 1; epoch <= epochs; ++epoch) {
+    shuffle(order.begin(), order.end(), rng);
+    float lr = static_cast<float>(rate / sqrt(double(epoch)));
+    for (uint32_t k : order) {
+      const PolicyDataset::Position &p = data.positions[k];
+      policy_probs(data, p, w, v, prob);
+      for (int i = 0; i < p.count; ++i) {
+        float g = static_cast<float>(prob[i] - (i == p.played));
+        float &wc = w[data.classes[p.first + i]];
+        wc -= lr * (g + static_cast<float>(l2) * wc);
+        v[data.dests[p.first + i]] -= lr * g;
+      }
+    }
+    PolicyScore train = score_policy(data, 0, train_end, w, v);
+    PolicyScore test = score_policy(data, train_end, total, w, v);
+    cerr << "epoch " << epoch << ": train loss " << train.loss
+         << ", holdout loss " << test.loss << " (uniform "
+         << test.uniform_loss << "), holdout accuracy " << test.accuracy
+         << endl;
+  }
+
+  policy.dest_weight = v;
+  vector<uint8_t> blob = policy.save();
+  policy.load(blob); // score what will actually ship
+  PolicyScore q = score_policy(data, train_end, total, policy.pattern_weight,
+                               policy.dest_weight);
+  cout << "holdout loss " << q.loss << " (uniform " << q.uniform_loss
+       << "), accuracy " << q.accuracy << ", destination weights open "
+       << policy.dest_weight[DEST_OPEN] << ", free "
+       << policy.dest_weight[DEST_FREE] << ", threat "
+       << policy.dest_weight[DEST_THREAT] << endl;
+  ofstream file(out_path, ios::binary);
+  if (!file.write(reinterpret_cast<const char *>(blob.data()), blob.size())) {
+    cerr << "cannot write " << out_path << endl;
+    return 1;
+  }
+  cout << "wrote " << out_path << " (" << blob.size() << " bytes)" << endl;
+  return 0;
+}
@@ -0,0 +1,224 @@
+#pragma once
+// Struct-of-arrays game kernel of the batched environment (vecenv.cpp).
+//
+// Holds N games and steps all of them at once, with rules that follow the
+// bitboard State. Kept in a header so the differential fuzzer can check it
+// move by move against State.
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "state.h"
+
+using namespace std;
+
+// Observation planes, all from the point of view of the player to move
+enum Plane {
+  PLANE_OWN = 0,     // own stones
+  PLANE_OPP = 1,     // opponent stones
+  PLANE_LEGAL = 2,   // legal moves
+  PLANE_OWN_SUB = 3, // cells of sub-boards won by the player to move
+  PLANE_OPP_SUB = 4, // cells of sub-boards won by the opponent
+  NUM_PLANES = 5
+};
+
+// ----------------------------------------------------------------------
+// Lookup tables
+// ----------------------------------------------------------------------
+struct VecEnvTables {
+  array<uint8_t, 512> win;           // 9-bit mask contains a winning line
+  array<array<uint8_t, 4>, 8> bits3; // 3-bit row mask -> 3 bytes of 0/1
+  array<int, 9> corner;              // row-major index of sub-board's cell 0
+
+  VecEnvTables() {
+    for (int m = 0; m < 512; ++m) {
+      win[m] = 0;
+      for (int w : WIN_LINES)
+        if ((m & w) == w)
+          win[m] = 1;
+    }
+    for (int m = 0; m < 8; ++m)
+      for (int k = 0; k < 4; ++k)
+        bits3[m][k] = k < 3 ? (m >> k) & 1 : 0;
+    for (int s = 0; s < 9; ++s)
+      corner[s] = (s / 3) * 27 + (s % 3) * 3;
+  }
+};
+
+static const VecEnvTables VT;
+
+// Write a sub-board's 9-bit mask into a row-major 9x9 plane
+inline void put_sub(uint8_t *plane, int s, int mask) {
+  uint8_t *p = plane + VT.corner[s];
+  memcpy(p, VT.bits3[mask & 7].data(), 3);
+  memcpy(p + 9, VT.bits3[(mask >> 3) & 7].data(), 3);
+  memcpy(p + 18, VT.bits3[(mask >> 6) & 7].data(), 3);
+}
+
+// ----------------------------------------------------------------------
+// Vectorised environment
+// ----------------------------------------------------------------------
+struct VecEnv {
+  int n;
+  vector<uint16_t> x, o; // [n * 9] stones per sub-board
+  vector<uint16_t> metaX, metaO, metaD;
+  vector<uint8_t> sub_idx; // 0-8, or 9 = any
+  vector<uint8_t> turnX;
+  vector<uint64_t> rng; // per-game xorshift state for sampling
+
+  VecEnv(int count, uint64_t seed)
+      : n(count), x(count * 9), o(count * 9), metaX(count), metaO(count),
+        metaD(count), sub_idx(count), turnX(count), rng(count) {
+    for (int i = 0; i < n; ++i) {
+      reset_one(i);
+      uint64_t z = seed + 0x9E3779B97F4A7C15ULL * (i + 1);
+      z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+      z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+      rng[i] = (z ^ (z >> 31)) | 1;
+    }
+  }
+
+  void reset_one(int i) {
+    memset(&x[i * 9], 0, 9 * sizeof(uint16_t));
+    memset(&o[i * 9], 0, 9 * sizeof(uint16_t));
+    metaX[i] = metaO[i] = metaD[i] = 0;
+    sub_idx[i] = 9;
+    turnX[i] = 1;
+  }
+
+  // Sub-boards the player to move may play in, as a 9-bit mask
+  int allowed_subs(int i) const {
+    int closed = metaX[i] | metaO[i] | metaD[i];
+    int t = sub_idx[i];
+    if (t < 9 && !((closed >> t) & 1) &&
+        (x[i * 9 + t] | o[i * 9 + t]) != FILLED_MASK)
+      return 1 << t;
+    return ~closed & FILLED_MASK;
+  }
+
+  bool is_legal(int i, int action) const {
+    if (action < 0 || action >= 81)
+      return false;
+    int r = action / 9, c = action % 9;
+    int s = (r / 3) * 3 + c / 3;
+    int pos = (r % 3) * 3 + c % 3;
+    return ((allowed_subs(i) >> s) & 1) &&
+           !(((x[i * 9 + s] | o[i * 9 + s]) >> pos) & 1);
+  }
+
+  // Play a legal action; returns the winner (0 ongoing, 1 X, -1 O, 2 draw)
+  int apply(int i, int action) {
+    int r = action / 9, c = action % 9;
+    int s = (r / 3) * 3 + c / 3;
+    int pos = (r % 3) * 3 + c % 3;
+    uint16_t &xb = x[i * 9 + s];
+    uint16_t &ob = o[i * 9 + s];
+    if (turnX[i])
+      xb |= 1 << pos;
+    else
+      ob |= 1 << pos;
+
+    int closed = metaX[i] | metaO[i] | metaD[i];
+    if (!((closed >> s) & 1)) {
+      if (VT.win[xb])
+        metaX[i] |= 1 << s;
+      else if (VT.win[ob])
+        metaO[i] |= 1 << s;
+      else if ((xb | ob) == FILLED_MASK)
+        metaD[i] |= 1 << s;
+      closed = metaX[i] | metaO[i] | metaD[i];
+    }
+
+    int winner = 0;
+    if (VT.win[metaX[i]])
+      winner = 1;
+    else if (VT.win[metaO[i]])
+      winner = -1;
+    else if (closed == FILLED_MASK) {
+      int xc = __builtin_popcount(metaX[i]);
+      int oc = __builtin_popcount(metaO[i]);
+      winner = xc > oc ? 1 : (oc > xc ? -1 : 2);
+    }
+
+    sub_idx[i] = ((closed >> pos) & 1) ? 9 : pos;
+    turnX[i] ^= 1;
+    return winner;
+  }
+
+  void observe(int i, uint8_t *obs, uint8_t *legal) const {
+    const uint16_t *own = turnX[i] ? &x[i * 9] : &o[i * 9];
+    const uint16_t *opp = turnX[i] ? &o[i * 9] : &x[i * 9];
+    int own_meta = turnX[i] ? metaX[i] : metaO[i];
+    int opp_meta = turnX[i] ? metaO[i] : metaX[i];
+    int allowed = allowed_subs(i);
+    for (int s = 0; s < 9; ++s) {
+      put_sub(obs + PLANE_OWN * 81, s, own[s]);
+      put_sub(obs + PLANE_OPP * 81, s, opp[s]);
+      int free_cells = ((allowed >> s) & 1) ? ~(own[s] | opp[s]) : 0;
+      put_sub(obs + PLANE_LEGAL * 81, s, free_cells);
+      put_sub(obs + PLANE_OWN_SUB * 81, s,
+              ((own_meta >> s) & 1) * FILLED_MASK);
+      put_sub(obs + PLANE_OPP_SUB * 81, s,
+              ((opp_meta >> s) & 1) * FILLED_MASK);
+    }
+    memcpy(legal, obs + PLANE_LEGAL * 81, 81);
+  }
+
+  void step(const int32_t *actions, uint8_t *obs, uint8_t *legal,
+            float *rewards, uint8_t *done) {
+    for (int i = 0; i < n; ++i) {
+      int mover = turnX[i] ? 1 : -1;
+      float reward = 0.0f;
+      bool finished = true;
+      if (!is_legal(i, actions[i])) {
+        reward = -1.0f;
+      } else {
+        int winner = apply(i, actions[i]);
+        if (winner == 0)
+          finished = false;
+        else if (winner != 2)
+          reward = winner == mover ? 1.0f : -1.0f;
+      }
+      if (finished)
+        reset_one(i);
+      rewards[i] = reward;
+      done[i] = finished;
+      observe(i, obs + size_t(i) * NUM_PLANES * 81, legal + size_t(i) * 81);
+    }
+  }
+
+  // Uniformly random legal action per game, for baselines and benchmarks
+  void sample(int32_t *actions) {
+    for (int i = 0; i < n; ++i) {
+      uint64_t &z = rng[i];
+      z ^= z << 13;
+      z ^= z >> 7;
+      z ^= z << 17;
+      int allowed = allowed_subs(i);
+      int free_masks[9], total = 0;
+      for (int s = 0; s < 9; ++s) {
+        int free_cells = ((allowed >> s) & 1)
+                             ? ~(x[i * 9 + s] | o[i * 9 + s]) & FILLED_MASK
+                             : 0;
+        free_masks[s] = free_cells;
+        total += __builtin_popcount(free_cells);
+      }
+      int k = static_cast<int>((z >> 32) % total);
+      for (int s = 0; s < 9; ++s) {
+        int pc = __builtin_popcount(free_masks[s]);
+        if (k >= pc) {
+          k -= pc;
+          continue;
+        }
+        int m = free_masks[s];
+        while (k--)
+          m &= m - 1;
+        int pos = __builtin_ctz(m);
+        actions[i] = ((s / 3) * 3 + pos / 3) * 9 + (s % 3) * 3 + pos % 3;
+        break;
+      }
+    }
+  }
+};
@@ -0,0 +1,99 @@
+#pragma once
+// Per-turn deadline guard that prints a move if the search overruns.
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <utility>
+
+using namespace std;
+
+// ----------------------------------------------------------------------
+// Search Watchdog
+// ----------------------------------------------------------------------
+// Armed once per turn with the turn deadline. If the main thread has not
+// answered by then (page faults, preemption, a slow arena reset), the
+// watchdog prints the best root move published so far, or the heuristic
+// move, and tells the main thread to abandon the turn. Whoever claims the
+// turn first is the only one allowed to print.
+static const double SEARCH_MARGIN = 0.015;   // search stops this early
+static const double WATCHDOG_MARGIN = 0.008; // watchdog answers this early
+
+struct Watchdog {
+  thread worker;
+  mutex mtx;
+  condition_variable cv;
+  bool armed, quit;
+  chrono::steady_clock::time_point deadline;
+  int fallback_cell;
+  atomic<int> best_cell;   // published by the search loop, -1 if none
+  atomic<bool> answered;   // set by whoever prints this turn's move
+  atomic<bool> abandon;    // asks the search loop to stop
+  int emitted_cell;        // move printed by the watchdog
+  int fired;               // turns answered by the watchdog
+
+  Watchdog()
+      : armed(false), quit(false), fallback_cell(-1), best_cell(-1),
+        answered(false), abandon(false), emitted_cell(-1), fired(0) {
+    worker = thread([this] { run(); });
+  }
+
+  ~Watchdog() {
+    {
+      lock_guard<mutex> lk(mtx);
+      quit = true;
+    }
+    cv.notify_one();
+    worker.join();
+  }
+
+  void arm(chrono::steady_clock::time_point when, pair<int, int> fallback) {
+    lock_guard<mutex> lk(mtx);
+    deadline = when;
+    fallback_cell = fallback.first * 9 + fallback.second;
+    best_cell.store(-1, memory_order_relaxed);
+    answered.store(false);
+    abandon.store(false);
+    emitted_cell = -1;
+    armed = true;
+    cv.notify_one();
+  }
+
+  // Returns true if the caller now owns this turn's output
+  bool claim() { return !answered.exchange(true); }
+
+  void disarm() {
+    lock_guard<mutex> lk(mtx);
+    armed = false;
+    cv.notify_one();
+  }
+
+  void publish(pair<int, int> mv) {
+    best_cell.store(mv.first * 9 + mv.second, memory_order_relaxed);
+  }
+
+  bool abandoned() const { return abandon.load(memory_order_relaxed); }
+
+  void run() {
+    unique_lock<mutex> lk(mtx);
+    while (!quit) {
+      if (!armed) {
+        cv.wait(lk);
+        continue;
+      }
+      if (cv.wait_until(lk, deadline) != cv_status::timeout || !armed)
+        continue;
+      armed = false;
+      abandon.store(true);
+      if (!claim())
+        continue;
+      int cell = best_cell.load(memory_order_relaxed);
+      emitted_cell = cell >= 0 ? cell : fallback_cell;
+      ++fired;
+      cout << emitted_cell / 9 << " " << emitted_cell % 9 << endl;
+    }
+  }
+};
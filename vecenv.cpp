@@ -0,0 +1,50 @@
+// Batched Ultimate Tic-Tac-Toe environment for reinforcement learning.
+//
+// Holds N games in struct-of-arrays form and steps all of them with one call;
+// the kernel itself lives in uttt/vecenv.h. Built as a shared library with a
+// C ABI so vecenv.py can drive it through ctypes and hand numpy arrays
+// straight to the step function:
+//
+//   g++ -O2 -std=c++17 -shared -fPIC vecenv.cpp -o libvecenv.so
+//
+// Actions are cell indices r * 9 + c. Every output buffer is row-major with
+// the environment index as the leading dimension:
+//   obs     uint8 [N][NUM_PLANES][81]  planes seen from the player to move
+//   legal   uint8 [N][81]              1 where the move is legal
+//   rewards float [N]                  for the player who just moved
+//   done    uint8 [N]                  game finished (env already reset)
+// A finished game is reset in place, so obs and legal always describe a live
+// position. An illegal action loses the game for the player who made it.
+
+#include <cstdint>
+
+#include "uttt/vecenv.h"
+
+// ----------------------------------------------------------------------
+// C ABI
+// ----------------------------------------------------------------------
+extern "C" {
+
+int uttt_vecenv_num_planes() { return NUM_PLANES; }
+
+void *uttt_vecenv_create(int n, uint64_t seed) { return new VecEnv(n, seed); }
+
+void uttt_vecenv_destroy(void *env) { delete static_cast<VecEnv *>(env); }
+
+void uttt_vecenv_reset(void *env, uint8_t *obs, uint8_t *legal) {
+  VecEnv *e = static_cast<VecEnv *>(env);
+  for (int i = 0; i < e->n; ++i) {
+    e->reset_one(i);
+    e->observe(i, obs + size_t(i) * NUM_PLANES * 81, legal + size_t(i) * 81);
+  }
+}
+
+void uttt_vecenv_step(void *env, const int32_t *actions, uint8_t *obs,
+                      uint8_t *legal, float *rewards, uint8_t *done) {
+  static_cast<VecEnv *>(env)->step(actions, obs, legal, rewards, done);
+}
+
+void uttt_vecenv_sample(void *env, int32_t *actions) {
+  static_cast<VecEnv *>(env)->sample(actions);
+}
+}
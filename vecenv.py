@@ -0,0 +1,110 @@
+"""
+Python binding for the batched C++ environment in vecenv.cpp.
+
+Build the library first:
+    g++ -O2 -std=c++17 -shared -fPIC vecenv.cpp -o libvecenv.so
+
+All buffers are numpy arrays owned by the VecEnv object and overwritten in
+place by every reset()/step() call; copy them if you need to keep a batch.
+"""
+
+import ctypes
+import os
+import sys
+import time
+
+import numpy as np
+
+_LIB_PATH = os.path.join(os.path.dirname(os.path.abspath(__file__)), "libvecenv.so")
+
+
+def _load(path: str = _LIB_PATH) -> ctypes.CDLL:
+    lib = ctypes.CDLL(path)
+    ptr = np.ctypeslib.ndpointer
+    lib.uttt_vecenv_num_planes.restype = ctypes.c_int
+    lib.uttt_vecenv_create.restype = ctypes.c_void_p
+    lib.uttt_vecenv_create.argtypes = [ctypes.c_int, ctypes.c_uint64]
+    lib.uttt_vecenv_destroy.argtypes = [ctypes.c_void_p]
+    lib.uttt_vecenv_reset.argtypes = [
+        ctypes.c_void_p,
+        ptr(np.uint8, flags="C_CONTIGUOUS"),
+        ptr(np.uint8, flags="C_CONTIGUOUS"),
+    ]
+    lib.uttt_vecenv_step.argtypes = [
+        ctypes.c_void_p,
+        ptr(np.int32, flags="C_CONTIGUOUS"),
+        ptr(np.uint8, flags="C_CONTIGUOUS"),
+        ptr(np.uint8, flags="C_CONTIGUOUS"),
+        ptr(np.float32, flags="C_CONTIGUOUS"),
+        ptr(np.uint8, flags="C_CONTIGUOUS"),
+    ]
+    lib.uttt_vecenv_sample.argtypes = [
+        ctypes.c_void_p,
+        ptr(np.int32, flags="C_CONTIGUOUS"),
+    ]
+    return lib
+
+
+class VecEnv:
+    """
+    N independent games stepped together:
+    - obs:     uint8 [N, planes, 9, 9] (own, opponent, legal, own sub-boards,
+               opponent sub-boards), from the view of the player to move
+    - legal:   uint8 [N, 81] legal move mask, actions are r * 9 + c
+    - rewards: float32 [N] for the player who just moved (+1/-1/0)
+    - done:    bool [N], finished games are reset automatically
+    """
+
+    def __init__(self, num_envs: int, seed: int = 0) -> None:
+        self._lib = _load()
+        self.num_envs = num_envs
+        self.num_planes = self._lib.uttt_vecenv_num_planes()
+        self._env = self._lib.uttt_vecenv_create(num_envs, seed)
+        self.obs = np.zeros((num_envs, self.num_planes, 9, 9), dtype=np.uint8)
+        self.legal = np.zeros((num_envs, 81), dtype=np.uint8)
+        self.rewards = np.zeros(num_envs, dtype=np.float32)
+        self._done = np.zeros(num_envs, dtype=np.uint8)
+        self._actions = np.zeros(num_envs, dtype=np.int32)
+
+    def __del__(self) -> None:
+        if getattr(self, "_env", None):
+            self._lib.uttt_vecenv_destroy(self._env)
+            self._env = None
+
+    def reset(self):
+        self._lib.uttt_vecenv_reset(self._env, self.obs, self.legal)
+        return self.obs, self.legal
+
+    def step(self, actions):
+        """One action per game; the C++ side reads exactly num_envs of them."""
+        actions = np.ascontiguousarray(actions, dtype=np.int32)
+        if actions.shape != (self.num_envs,):
+            raise ValueError(
+                f"expected actions of shape ({self.num_envs},), got {actions.shape}"
+            )
+        self._lib.uttt_vecenv_step(
+            self._env, actions, self.obs, self.legal, self.rewards, self._done
+        )
+        return self.obs, self.legal, self.rewards, self._done.view(np.bool_)
+
+    def sample_actions(self):
+        """Uniformly random legal action for every game."""
+        self._lib.uttt_vecenv_sample(self._env, self._actions)
+        return self._actions
+
+
+def bench(num_envs: int = 4096, seconds: float = 2.0) -> None:
+    env = VecEnv(num_envs, seed=560)
+    env.reset()
+    steps = games = 0
+    start = time.perf_counter()
+    while time.perf_counter() - start < seconds:
+        _, _, _, done = env.step(env.sample_actions())
+        steps += num_envs
+        games += int(done.sum())
+    elapsed = time.perf_counter() - start
+    print(f"{num_envs} envs: {steps / elapsed:,.0f} steps/sec, {games / elapsed:,.0f} games/sec")
+
+
+if __name__ == "__main__":
+    bench(*(int(a) for a in sys.argv[1:2]))